@@ -25,11 +25,35 @@
 //     number of remaining tiles in the starting pile.
 //
 // Lastly... if you think this is hard to read - I had to write it. :)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <sstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 
 // We'd use smaller types if we could. However, be aware that some operations
@@ -62,22 +86,279 @@ constexpr Side START{TILES, 1};
 // You end with no tiles remaining and no straggling tiles still on the path.
 constexpr Side COMPLETE{0, 0};
 
-// Enable/disable more comprehensive game logging.
-constexpr bool VERBOSE = true;
+
+// Step a SplitMix64 generator, for seeding and for constant tables of keys.
+constexpr uint64_t _splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+
+// A set of four tetrahedral dice.
+//
+// Each die shows a marked tip half the time, so a roll is the number of set
+// bits among four random bits, which is Bin(4, 0.5). One 64-bit draw from a
+// xoshiro256** generator is good for 16 rolls.
+//
+// Dice are a roll source: anything with a `roll()` that returns the next
+// `Steps`, which is all that `playOneRoll` and `playOneGame` need.
+//
+// See: https://prng.di.unimi.it/
+class Dice {
+public:
+    // Seed the generator by expanding `seed` with SplitMix64, as recommended.
+    //
+    // A master seed splits into any number of independent streams, one per
+    // `stream` index (e.g. one per game), in constant time. Stream i of a seed
+    // is always the same, whichever order the streams are made in.
+    explicit Dice(uint64_t seed, uint64_t stream = 0) {
+        // SplitMix64 is a bijection of its state, so distinct streams start
+        // from distinct seeds.
+        seed ^= _splitmix64(stream);
+        for (uint64_t& word : _state) word = _splitmix64(seed);
+    }
+    // Start from an exact generator state, which mustn't be all zero.
+    explicit Dice(const std::array<uint64_t, 4>& state) : _state(state) { /* empty */ }
+
+    [[ nodiscard ]] Steps roll() {
+        if (_left == 0) {
+            _bits = next();
+            _left = 16;
+        }
+        Steps steps = __builtin_popcountll(_bits & 0xF);
+        _bits >>= 4;
+        --_left;
+        return steps;
+    }
+
+    // The next raw 64-bit output of xoshiro256**.
+    [[ nodiscard ]] uint64_t next() {
+        uint64_t result = _rotateLeft(_state[1] * 5, 7) * 9;
+        uint64_t t = _state[1] << 17;
+        _state[2] ^= _state[0];
+        _state[3] ^= _state[1];
+        _state[1] ^= _state[2];
+        _state[0] ^= _state[3];
+        _state[2] ^= t;
+        _state[3] = _rotateLeft(_state[3], 45);
+        return result;
+    }
+
+private:
+    static constexpr uint64_t _rotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::array<uint64_t, 4> _state;
+    uint64_t _bits = 0;  // Unused rolls, four bits apiece...
+    unsigned _left = 0;  // ...and how many of them there are.
+};
 
 
-// Roll the tetrahedra by sampling from Bin(4, 0.5).
+// A set of four tetrahedral dice, rolled by a counter-based generator.
 //
-// Unfamiliar with (pseudo-)randomness in C++?
-// See: https://en.cppreference.com/w/cpp/numeric/random
-[[ nodiscard ]] Steps getRandomRoll() {
-    // NOTE(sredmond): These are static locals only because of laziness.
-    // Randomly seed the (32-bit) generator.
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
+// Roll k of game g under a seed is a pure function of (seed, g, k): Philox4x32-10
+// keyed by the seed turns the counter (k / 32, g) into 128 random bits, which
+// are 32 rolls of four bits apiece. So any roll can be had without rolling the
+// ones before it, and shards of a tournament match bit for bit wherever
+// they're played. It's a roll source like `Dice`, but slower to roll in
+// sequence (10 rounds per 32 rolls rather than one xoshiro step per 16).
+//
+// See: Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3" (2011).
+class PhiloxDice {
+public:
+    using Block = std::array<uint32_t, 4>;
+    static constexpr uint64_t ROLLS_PER_BLOCK = 32;
+
+    // Roll game `game` under `seed`, starting from roll `first`.
+    PhiloxDice(uint64_t seed, uint64_t game, uint64_t first = 0)
+        : _seed(seed), _game(game), _next(first) { /* empty */ }
+
+    [[ nodiscard ]] Steps roll() {
+        if (_next / ROLLS_PER_BLOCK != _index) {
+            _index = _next / ROLLS_PER_BLOCK;
+            _block = block(_seed, _game, _index);
+        }
+        Steps steps = _nibble(_block, _next % ROLLS_PER_BLOCK);
+        ++_next;
+        return steps;
+    }
+
+    // Roll `k` of game `game` under `seed`.
+    [[ nodiscard ]] static Steps rollAt(uint64_t seed, uint64_t game, uint64_t k) {
+        return _nibble(block(seed, game, k / ROLLS_PER_BLOCK), k % ROLLS_PER_BLOCK);
+    }
+
+    // Philox4x32-10 of the counter (index, game) under the key `seed`.
+    [[ nodiscard ]] static Block block(uint64_t seed, uint64_t game, uint64_t index) {
+        Block counter = {uint32_t(index), uint32_t(index >> 32), uint32_t(game), uint32_t(game >> 32)};
+        return philox(counter, {uint32_t(seed), uint32_t(seed >> 32)});
+    }
+
+    [[ nodiscard ]] static Block philox(Block counter, std::array<uint32_t, 2> key) {
+        for (int round = 0; round < 10; ++round) {
+            uint64_t product0 = uint64_t(_M0) * counter[0];
+            uint64_t product1 = uint64_t(_M1) * counter[2];
+            counter = {uint32_t(product1 >> 32) ^ counter[1] ^ key[0], uint32_t(product1),
+                       uint32_t(product0 >> 32) ^ counter[3] ^ key[1], uint32_t(product0)};
+            key[0] += _W0;
+            key[1] += _W1;
+        }
+        return counter;
+    }
+
+    // Write rolls [first, first + count) of game `game` under `seed` to `out`.
+    //
+    // Blocks are generated `_LANES` at a time, one per lane of plain arrays,
+    // so that the compiler turns each step into SIMD instructions across the
+    // lanes (e.g. PMULUDQ for the multiplies).
+    static void rolls(uint64_t seed, uint64_t game, uint64_t first, size_t count, Steps* out) {
+        const uint64_t last = first + count;
+        for (uint64_t index = first / ROLLS_PER_BLOCK; index * ROLLS_PER_BLOCK < last; index += _LANES) {
+            uint32_t c[4][_LANES];
+            for (size_t lane = 0; lane < _LANES; ++lane) {
+                c[0][lane] = uint32_t(index + lane);
+                c[1][lane] = uint32_t((index + lane) >> 32);
+                c[2][lane] = uint32_t(game);
+                c[3][lane] = uint32_t(game >> 32);
+            }
+            _philoxLanes(c, seed);
+
+            // Count the bits of every nibble at once, then spread the nibbles
+            // out into rolls, lane by lane.
+            Steps batch[_LANES * ROLLS_PER_BLOCK];
+            for (size_t word = 0; word < 4; ++word) {
+                for (size_t lane = 0; lane < _LANES; ++lane) {
+                    uint32_t x = nibbleCounts(c[word][lane]);
+                    for (size_t nibble = 0; nibble < 8; ++nibble) {
+                        batch[lane * ROLLS_PER_BLOCK + 8 * word + nibble] = (x >> (4 * nibble)) & 0xF;
+                    }
+                }
+            }
+            const uint64_t begin = std::max(first, index * ROLLS_PER_BLOCK);
+            const uint64_t end = std::min(last, (index + _LANES) * ROLLS_PER_BLOCK);
+            std::copy(batch + (begin - index * ROLLS_PER_BLOCK), batch + (end - index * ROLLS_PER_BLOCK),
+                      out + (begin - first));
+        }
+    }
+
+    // Write block `index[i]` of game `game[i]` under `seed` to `out[i]`, for
+    // each of `count` counters, generated `_LANES` at a time like `rolls`.
+    static void blocks(uint64_t seed, const uint64_t* game, const uint64_t* index, size_t count, Block* out) {
+        for (size_t begin = 0; begin < count; begin += _LANES) {
+            const size_t lanes = std::min(_LANES, count - begin);
+            uint32_t c[4][_LANES] = {};
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                c[0][lane] = uint32_t(index[begin + lane]);
+                c[1][lane] = uint32_t(index[begin + lane] >> 32);
+                c[2][lane] = uint32_t(game[begin + lane]);
+                c[3][lane] = uint32_t(game[begin + lane] >> 32);
+            }
+            _philoxLanes(c, seed);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                out[begin + lane] = {c[0][lane], c[1][lane], c[2][lane], c[3][lane]};
+            }
+        }
+    }
+
+    // Replace each nibble of `x` with the number of bits set in it, i.e. with
+    // the roll it makes (SWAR).
+    [[ nodiscard ]] static constexpr uint32_t nibbleCounts(uint32_t x) {
+        x = x - ((x >> 1) & 0x55555555);
+        return (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    }
+
+private:
+    static constexpr uint32_t _M0 = 0xD2511F53, _M1 = 0xCD9E8D57;  // Multipliers...
+    static constexpr uint32_t _W0 = 0x9E3779B9, _W1 = 0xBB67AE85;  // ...and Weyl key increments.
+    static constexpr size_t _LANES = 8;
+
+    // Philox4x32-10 of the counters (c[0][lane], ..., c[3][lane]) in place,
+    // one per lane of plain arrays, so that each step vectorizes across them.
+    static void _philoxLanes(uint32_t (&c)[4][_LANES], uint64_t seed) {
+        uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+        for (int round = 0; round < 10; ++round) {
+            for (size_t lane = 0; lane < _LANES; ++lane) {
+                uint64_t product0 = uint64_t(_M0) * c[0][lane];
+                uint64_t product1 = uint64_t(_M1) * c[2][lane];
+                uint32_t n0 = uint32_t(product1 >> 32) ^ c[1][lane] ^ k0;
+                uint32_t n2 = uint32_t(product0 >> 32) ^ c[3][lane] ^ k1;
+                c[1][lane] = uint32_t(product1);
+                c[3][lane] = uint32_t(product0);
+                c[0][lane] = n0;
+                c[2][lane] = n2;
+            }
+            k0 += _W0;
+            k1 += _W1;
+        }
+    }
+
+    static Steps _nibble(const Block& block, uint64_t i) {
+        return __builtin_popcount((block[i / 8] >> (4 * (i % 8))) & 0xF);
+    }
+
+    uint64_t _seed;
+    uint64_t _game;
+    uint64_t _next;  // The index of the next roll...
+    uint64_t _index = UINT64_MAX;  // ...and of the block in `_block`.
+    Block _block{};
+};
+
+
+// Verify that rolls come up with the right frequencies (to within a
+// chi-squared test).
+template <typename Roller>
+bool _verifyRollFrequencies(Roller&& dice) {
+    const uint64_t rolls = 1 << 24;
+    std::array<uint64_t, 5> counts{};
+    for (uint64_t i = 0; i < rolls; ++i) counts[dice.roll()]++;
+    double chiSquared = 0;
+    for (Steps steps = 0; steps <= 4; ++steps) {
+        double expected = rolls * std::array<double, 5>{1, 4, 6, 4, 1}[steps] / 16;
+        chiSquared += (counts[steps] - expected) * (counts[steps] - expected) / expected;
+    }
+    return chiSquared < 18.47;  // The 99.9th percentile with 4 degrees of freedom.
+}
+
+// Verify the generator against the reference outputs of xoshiro256**.
+bool _verifyDice() {
+    Dice reference({1, 2, 3, 4});
+    for (uint64_t expected : {11520ull, 0ull, 1509978240ull, 1215971899390074240ull}) {
+        if (reference.next() != expected) return false;
+    }
+    return _verifyRollFrequencies(Dice(1));
+}
+
+// Verify Philox against the known-answer tests from Random123, and that every
+// way of getting a roll (in sequence, at random, in a batch) agrees.
+bool _verifyPhiloxDice() {
+    using Block = PhiloxDice::Block;
+    if (PhiloxDice::philox({0, 0, 0, 0}, {0, 0}) != Block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}) return false;
+    if (PhiloxDice::philox({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff})
+        != Block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}) return false;
+    if (PhiloxDice::philox({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0})
+        != Block{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}) return false;
+
+    std::mt19937_64 gen(13);
+    for (size_t trial = 0; trial < 1000; ++trial) {
+        uint64_t seed = gen(), game = gen(), first = gen() % (1 << 20);
+        size_t count = gen() % 1000;
+        std::vector<Steps> batch(count);
+        PhiloxDice::rolls(seed, game, first, count, batch.data());
+        PhiloxDice dice(seed, game, first);
+        for (size_t i = 0; i < count; ++i) {
+            Steps steps = dice.roll();
+            if (steps != batch[i] || steps != PhiloxDice::rollAt(seed, game, first + i)) return false;
+        }
+    }
+    return _verifyRollFrequencies(PhiloxDice(1, 0));
+}
+
 
-    static std::binomial_distribution<Steps> d(4, 0.5);
-    return d(gen);
+// Pick a fresh master seed from the system's entropy.
+[[ nodiscard ]] uint64_t randomSeed() {
+    std::random_device rd;
+    return uint64_t(rd()) << 32 | rd();
 }
 
 
@@ -88,7 +369,10 @@ constexpr bool VERBOSE = true;
 //     const Options options = getOptions(...);
 //     if (options[4]) ...  // You can move from position 4.
 //
-[[ nodiscard ]] const Options getOptions(Side self, Side other, Steps steps) {
+// `StepsT` is either `Steps` or a `StepsConstant` (see `withSteps`), which
+// gives each roll its own copy with constant shifts.
+template <typename StepsT>
+[[ nodiscard ]] inline Options _getOptions(Side self, Side other, StepsT steps) {
     // Every position starts as valid.
     Options options{0x7FFF};
     // A position is valid iff all of the following are true:
@@ -102,20 +386,37 @@ constexpr bool VERBOSE = true;
     options &= 0xFFFF >> steps;
     return options;
 }
+[[ nodiscard ]] const Options getOptions(Side self, Side other, Steps steps) {
+    return _getOptions(self, other, steps);
+}
+
+
+// A record of a move, with enough detail to take it back (see `undo`).
+struct Undo {
+    Position start;
+    Position end;
+    bool captured;  // Whether an opponent's piece was sent back to their pile.
+    bool emptied;  // Whether the move took the last tile from the pile.
+    bool again;  // Whether the current player goes again.
+};
 
 
-// Attempt to apply a move, and return whether the current player goes again.
+// Attempt to apply a move, and return a record of it. Most callers only care
+// whether the current player goes again, i.e. `apply(...).again`.
 //
 // The game state (i.e. the two sides) are updated by reference.
 //
 // Pre: The proposed move is valid. This isn't the place for error checking.
-[[ nodiscard ]] bool apply(Side& self, Side& other, Position start, Steps steps) {
+template <typename StepsT>
+[[ nodiscard ]] inline Undo _apply(Side& self, Side& other, Position start, StepsT steps) {
     Position end = start + steps;
+    Undo move{start, end, false, false, false};
 
     // Pick up the piece from the start of the move...
     if (start == 0) {
         self.remaining--;
-        if (self.remaining == 0) self.occupied.reset(0);
+        move.emptied = self.remaining == 0;
+        if (move.emptied) self.occupied.reset(0);
     }
     else self.occupied.reset(start);
     // ...and place it at the end of the move.
@@ -128,10 +429,68 @@ constexpr bool VERBOSE = true;
         other.occupied.reset(end);
         other.remaining++;
         other.occupied.set(0);
+        move.captured = true;
     }
 
     // Go again if we ended on a rosette.
-    return end == 4 || end == 8 || end == 14;
+    move.again = end == 4 || end == 8 || end == 14;
+    return move;
+}
+[[ nodiscard ]] Undo apply(Side& self, Side& other, Position start, Steps steps) {
+    return _apply(self, other, start, steps);
+}
+
+
+// A roll known at compile time.
+template <Steps S>
+using StepsConstant = std::integral_constant<Steps, S>;
+
+// Call `f(StepsConstant<S>{})` for `S == steps`, so that the switch on the roll
+// happens once per turn and everything under `f` sees a constant, e.g.:
+//
+//     withSteps(steps, [&](auto s) { options = getOptions<s>(self, other); });
+//
+// Pre: `steps` is 1..4. A roll of 0 has no moves to generate.
+template <typename F>
+inline decltype(auto) withSteps(Steps steps, F&& f) {
+    switch (steps) {
+    case 1: return f(StepsConstant<1>{});
+    case 2: return f(StepsConstant<2>{});
+    case 3: return f(StepsConstant<3>{});
+    default: return f(StepsConstant<4>{});
+    }
+}
+
+// `getOptions` and `apply` for a roll of `S`.
+template <Steps S>
+[[ nodiscard ]] inline Options getOptions(Side self, Side other) {
+    return _getOptions(self, other, StepsConstant<S>{});
+}
+template <Steps S>
+[[ nodiscard ]] inline Undo apply(Side& self, Side& other, Position start) {
+    return _apply(self, other, start, StepsConstant<S>{});
+}
+
+
+// Take back a move made by `apply`, restoring the game state exactly.
+//
+// A pair of sides is only a few bytes, so copying it is cheaper than undoing a
+// move: perft runs at 0.6-0.8x the speed with make/unmake (see `ur bench`).
+// The search copies instead, and this is kept for checking `apply`.
+void undo(Side& self, Side& other, const Undo& move) {
+    // Put back the opponent's piece, if we captured it...
+    if (move.captured) {
+        other.remaining--;
+        if (other.remaining == 0) other.occupied.reset(0);
+        other.occupied.set(move.end);
+    }
+    // ...then take our piece back to where it started.
+    if (move.end < 15) self.occupied.reset(move.end);
+    if (move.start == 0) {
+        self.remaining++;
+        if (move.emptied) self.occupied.set(0);
+    }
+    else self.occupied.set(move.start);
 }
 
 
@@ -184,185 +543,4151 @@ bool _verifySides(Side self, Side other) {
 }
 
 
-/**********
- * AGENTS *
- **********/
+/****************
+ * PACKED STATE *
+ ****************/
 
-// An abstract agent for Ur.
+// The whole game state packed into a single 64-bit word.
 //
-// A concrete subclass must override `getMove(...)`. If an implementation wants
-// to signal a failure, it should return `INVALID`.
+// Each side takes one 32-bit half. The current player (`self`) lives in the low
+// half and the opponent (`other`) in the high half::
 //
-// An agent should be constructed with a name, although subclasses can choose to
-// provide a default name.
-class Agent {
-public:
-    Agent(std::string name) : _name(name) { /* empty */ }
-    virtual ~Agent() { /* empty */ };
-    virtual Position getMove(Side self, Side other, Steps steps, Options options) = 0;
-    [[ nodiscard ]] std::string getName() const { return _name; }
-
-    static constexpr Position INVALID{15};  // It's invalid to move from spot 15.
-protected:
-    std::string _name;
+//     bits  0..15  occupied (same layout as `Side::occupied`)
+//     bits 16..19  remaining
+//     bit  31      set iff this half belongs to the first player
+//
+// Exactly one half has bit 31 set, so passing the turn is a single rotation
+// and the side to move travels along with the sides for free.
+//
+// This is what the solvers, tables and search work on, since it ranks, hashes
+// and stores as one word. `playOneGame` stays on a pair of `Side`s, which is
+// what `Agent::getMove` takes: a playout on `GameState` is no faster (see
+// `benchState`), as both fit in registers and cost the same few operations
+// per roll, so converting for every move would only add work.
+struct GameState {
+    uint64_t bits;
 };
+inline bool operator==(GameState lhs, GameState rhs) { return lhs.bits == rhs.bits; }
+inline bool operator!=(GameState lhs, GameState rhs) { return lhs.bits != rhs.bits; }
 
+constexpr uint64_t HALF_OCCUPIED = 0xFFFF;
+constexpr uint64_t HALF_REMAINING = 0xF0000;
+constexpr uint64_t HALF_FIRST = 0x80000000;
+constexpr unsigned REMAINING_SHIFT = 16;
 
-// A concrete agent that advances the piece farthest from the end.
-class FarthestAgent : public Agent {
-public:
-    FarthestAgent() : Agent("Furthest") { /* empty */ }
-    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
-        for (size_t i = 0; i < 15; ++i) {
-            if (options.test(i)) return i;
-        }
-        return INVALID;
-    }
-};
+[[ nodiscard ]] inline uint64_t packSide(Side side) {
+    return side.occupied.to_ullong() | uint64_t{side.remaining} << REMAINING_SHIFT;
+}
 
+[[ nodiscard ]] constexpr Side unpackSide(uint64_t half) {
+    return Side{uint16_t((half & HALF_REMAINING) >> REMAINING_SHIFT), half & HALF_OCCUPIED};
+}
 
-// A concrete agent that advances the piece closest to the end.
-class ClosestAgent : public Agent {
-public:
-    ClosestAgent() : Agent("Closest") { /* empty */ }
-    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
-        for (int i = 14; i >= 0; --i) {  // Needs to be int, not size_t.
-            if (options.test(i)) return i;
-        }
-        return INVALID;
-    }
-};
+// Pack two sides, where `firstToMove` says whether `self` is the first player.
+[[ nodiscard ]] inline GameState pack(Side self, Side other, bool firstToMove) {
+    return GameState{packSide(self) | packSide(other) << 32
+                     | (firstToMove ? HALF_FIRST : HALF_FIRST << 32)};
+}
 
+[[ nodiscard ]] constexpr Side selfSide(GameState state) { return unpackSide(state.bits); }
+[[ nodiscard ]] constexpr Side otherSide(GameState state) { return unpackSide(state.bits >> 32); }
+[[ nodiscard ]] constexpr bool firstToMove(GameState state) { return state.bits & HALF_FIRST; }
 
-// A concrete agent that asks the user to choose from among available options.
-class InteractiveAgent : public Agent {
-public:
-    InteractiveAgent(std::string name) : Agent(name) { /* empty */}
-    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
-        std::cout << "Hello, " << _name << "!" << std::endl;
-        std::cout << "The current state (you are shown on top) is: " << std::endl;
-        display(self, other);
-        std::cout << "You rolled a " << +steps << "." << std::endl;
-        std::cout << "Your options are: " << std::endl;
-        for (size_t i = 0; i < 15; ++i) {
-            if (options.test(i)) std::cout << "> " << i << std::endl;
-        }
-        // Read the user's input.
-        std::cout << "What do you choose? ";
-        std::cout.flush();
-        uint16_t move = INVALID;  // Be wary of implicit widening and narrowing.
-        while (true) {
-            std::string line;
-            if (!getline(std::cin, line)) {
-                std::cerr << "Unexpected end of input." << std::endl;
-            }
-            // Ideally, I'd also trim the line.
-            std::istringstream stream(line);
-            stream >> move;
-            if (stream.fail() || !stream.eof()) {
-                std::cerr << "Illegal format." << std::endl;
-                std::cout << "Please try again: ";
-                std::cout.flush();
-                continue;
-            }
-            if (!options[move]) {
-                std::cerr << "Invalid option." << std::endl;
-                std::cout << "Please try again: ";
-                std::cout.flush();
-                continue;
-            }
-            break;
-        }
-        return move;
-    }
-};
+// Hand the move over to the opponent.
+[[ nodiscard ]] constexpr GameState swapped(GameState state) {
+    return GameState{state.bits << 32 | state.bits >> 32};
+}
 
+// Whether either side has borne off all of its tiles.
+[[ nodiscard ]] constexpr bool isOver(GameState state) {
+    return (state.bits & (HALF_OCCUPIED | HALF_REMAINING)) == 0
+        || (state.bits & (HALF_OCCUPIED | HALF_REMAINING) << 32) == 0;
+}
 
-/************
- * GAMEPLAY *
- ************/
+// The packed equivalent of `getOptions(Side, Side, Steps)`.
+template <typename StepsT>
+[[ nodiscard ]] inline Options _getOptions(GameState state, StepsT steps) {
+    uint64_t occupied = state.bits & 0x7FFF;
+    uint64_t options = occupied & ~(occupied >> steps);
+    options &= ~(state.bits >> 32 & 0x0100);
+    options &= 0xFFFF >> steps;
+    return Options{options};
+}
+[[ nodiscard ]] inline Options getOptions(GameState state, Steps steps) {
+    return _getOptions(state, steps);
+}
+template <Steps S>
+[[ nodiscard ]] inline Options getOptions(GameState state) {
+    return _getOptions(state, StepsConstant<S>{});
+}
 
-// Play out one roll and return whether the current player goes again.
-bool playOneRoll(const std::unique_ptr<Agent>& player, Side& self, Side& other) {
-    std::string name = player->getName();
+// The packed equivalent of `apply(Side&, Side&, Position, Steps)`.
+//
+// Like the original, this does not pass the turn; call `swapped` for that.
+//
+// Pre: The proposed move is valid.
+template <typename StepsT>
+[[ nodiscard ]] inline bool _apply(GameState& state, Position start, StepsT steps) {
+    Position end = start + steps;
+    uint64_t bits = state.bits;
 
-    // Roll the tetrahedra to determine the number of steps.
-    Steps steps = getRandomRoll();
+    // Pick up the piece from the start of the move...
+    if (start == 0) {
+        bits -= uint64_t{1} << REMAINING_SHIFT;
+        if ((bits & HALF_REMAINING) == 0) bits &= ~uint64_t{1};
+    }
+    else bits &= ~(uint64_t{1} << start);
+    // ...and place it at the end of the move (a no-op for position 15).
+    bits |= uint64_t{1} << end & 0x7FFF;
 
-    if (VERBOSE) std::cout << name << " rolls a " << +steps << "." << std::endl;
+    // Send a captured opponent back to their pile.
+    uint64_t hit = bits & uint64_t{0x1FE0} << 32 & uint64_t{1} << (end + 32);
+    if (hit) {
+        bits ^= hit;
+        bits += uint64_t{1} << (REMAINING_SHIFT + 32);
+        bits |= uint64_t{1} << 32;
+    }
 
-    // Don't bother asking the agent for a move if the roll was a zero.
-    if (steps == 0) return false;
+    state.bits = bits;
+    return end == 4 || end == 8 || end == 14;
+}
+[[ nodiscard ]] inline bool apply(GameState& state, Position start, Steps steps) {
+    return _apply(state, start, steps);
+}
+template <Steps S>
+[[ nodiscard ]] inline bool apply(GameState& state, Position start) {
+    return _apply(state, start, StepsConstant<S>{});
+}
 
-    // Precompute the valid moves. Sometimes there are none, so we move on.
-    Options options = getOptions(self, other, steps);
-    if (options == 0) {
-        if (VERBOSE) std::cout << "No legal moves." << std::endl;
-        return false;
-    }
+// Verify that the packed game state is valid.
+bool _verifyState(GameState state) {
+    uint64_t firsts = state.bits & (HALF_FIRST | HALF_FIRST << 32);
+    return _verifySides(selfSide(state), otherSide(state))
+        && (firsts == HALF_FIRST || firsts == HALF_FIRST << 32)
+        && (state.bits & ~(HALF_OCCUPIED | HALF_REMAINING | HALF_FIRST) & 0x7FFFFFFF) == 0
+        && (state.bits >> 32 & ~(HALF_OCCUPIED | HALF_REMAINING | HALF_FIRST)) == 0;
+}
 
-    // Ask the agent for a move.
-    Position start = player->getMove(self, other, steps, options);
-    if (VERBOSE) std::cout << name << " chooses " << +start << "." << std::endl;
 
-    // Submitting an invalid move passes your turn.
-    if (start == Agent::INVALID || !options[start]) {
-        if (VERBOSE) std::cout << "Oh no! An invalid move..." << std::endl;
-        return false;
-    }
+/***********
+ * RANKING *
+ ***********/
 
-    // Apply the move to the game state.
-    return apply(self, other, start, steps);
-}
+// A perfect ranking of every legal position onto [0, RANK_COUNT).
+//
+// A position is a pair of sides (`self`, `other`) that passes `_verifySides`
+// and where neither side has more than `TILES` tiles in play. We split the path
+// into 6 private cells per side (positions 1..4 and 13..14) and 8 shared cells
+// (positions 5..12), and order positions by, in turn:
+// 1. The number of tiles borne off by both sides, then by `self`. This keeps
+//    every layer of the game contiguous, since that number never decreases.
+// 2. The number of shared cells held by `self` and by `other`.
+// 3. The shared cells held by `self`, then the shared cells held by `other`
+//    among the ones left over, both in colexicographic order.
+// 4. The private cells of `self`, then of `other`, by size and then colex.
+// The starting pile isn't ranked at all; it's whatever is left over.
+//
+// Colex order has the nice property that a subset's rank doesn't depend on the
+// size of the universe, so a single 8-bit table serves every case above.
 
+using Rank = uint64_t;
 
-// Play one game of Ur.
-bool playOneGame(const std::unique_ptr<Agent>& first, const std::unique_ptr<Agent>& second) {
-    Side left = START;
-    Side right = START;
+// The number of tiles a side has borne off.
+[[ nodiscard ]] constexpr unsigned finished(uint16_t remaining, uint16_t occupied) {
+    return TILES - remaining - __builtin_popcount(occupied & 0x7FFE);
+}
+[[ nodiscard ]] inline unsigned finished(Side side) {
+    return finished(side.remaining, side.occupied.to_ulong());
+}
 
-    uint64_t rolls = 0;  // Track the length of the game.
-    bool current = true;  // Whether the current player is the first player.
-    while (left != COMPLETE && right != COMPLETE) {
-        if (VERBOSE) display(left, right);
+[[ nodiscard ]] constexpr uint16_t _privateCells(uint16_t occupied) {
+    return (occupied >> 1 & 0x0F) | (occupied >> 9 & 0x30);
+}
+[[ nodiscard ]] constexpr uint16_t _fromPrivateCells(uint16_t cells) {
+    return (cells & 0x0F) << 1 | (cells & 0x30) << 9;
+}
 
-        const std::unique_ptr<Agent>& player = current ? first : second;
+// Keep the bits of `value` selected by the 8-bit `mask`, packed together at the
+// bottom. This is PEXT, written without branches for portability.
+[[ nodiscard ]] constexpr uint32_t _compress(uint32_t value, uint32_t mask) {
+    uint32_t result = 0, count = 0;
+    for (unsigned cell = 0; cell < 8; ++cell) {
+        uint32_t selected = mask >> cell & 1;
+        result |= (value >> cell & selected) << count;
+        count += selected;
+    }
+    return result;
+}
+// The inverse of `_compress`: spread the low bits of `value` over `mask` (PDEP).
+[[ nodiscard ]] constexpr uint32_t _expand(uint32_t value, uint32_t mask) {
+    uint32_t result = 0, count = 0;
+    for (unsigned cell = 0; cell < 8; ++cell) {
+        uint32_t selected = mask >> cell & 1;
+        result |= (value >> count & selected) << cell;
+        count += selected;
+    }
+    return result;
+}
 
-        // The current player's side is `self`; the opponent's side is `other`.
-        Side& self = current ? left : right;
-        Side& other = current ? right : left;
+[[ nodiscard ]] constexpr uint64_t _binomial(unsigned n, unsigned k) {
+    if (k > n) return 0;
+    uint64_t result = 1;
+    for (unsigned i = 1; i <= k; ++i) result = result * (n - k + i) / i;
+    return result;
+}
 
-        // Let the current player play out a roll.
-        bool again = playOneRoll(player, self, other);
-        ++rolls;
-        current = !(current ^ again);
+// All 8-bit masks ordered by size, then colex; and the inverse permutation.
+// The same again for the 6-bit masks of private cells.
+struct _SubsetOrder {
+    std::array<uint8_t, 256> mask{};
+    std::array<uint8_t, 256> rank{};  // Within masks of the same size.
+    std::array<uint8_t, 256> size{};  // A portable popcount.
+    std::array<uint16_t, 10> begin{};  // Where each size starts in `mask`.
+    std::array<uint8_t, 64> privateMask{};
+    std::array<uint8_t, 64> privateRank{};  // Among all 6-bit masks.
+    std::array<uint8_t, 8> privateBegin{};
+};
+constexpr _SubsetOrder _makeSubsetOrder() {
+    _SubsetOrder order;
+    for (unsigned size = 0; size <= 8; ++size) {
+        order.begin[size + 1] = order.begin[size] + _binomial(8, size);
     }
-    if (VERBOSE) std::cout << "Ended after " << rolls << " rolls." << std::endl;
-    return left == COMPLETE;
+    for (unsigned size = 0; size <= 6; ++size) {
+        order.privateBegin[size + 1] = order.privateBegin[size] + _binomial(6, size);
+    }
+    for (unsigned mask = 0; mask < 256; ++mask) {
+        // Colex rank: the sum of C(cell, i + 1) over the i-th set cell.
+        unsigned size = 0;
+        uint64_t colex = 0;
+        for (unsigned cell = 0; cell < 8; ++cell) {
+            if (mask >> cell & 1) colex += _binomial(cell, ++size);
+        }
+        order.rank[mask] = colex;
+        order.size[mask] = size;
+        order.mask[order.begin[size] + colex] = mask;
+        if (mask < 64) {
+            order.privateRank[mask] = order.privateBegin[size] + colex;
+            order.privateMask[order.privateBegin[size] + colex] = mask;
+        }
+    }
+    return order;
 }
+constexpr _SubsetOrder SUBSETS = _makeSubsetOrder();
 
+// The number of private-cell subsets with at most `limit` cells.
+[[ nodiscard ]] constexpr uint16_t _privateCount(int limit) {
+    return limit < 0 ? 0 : SUBSETS.privateBegin[std::min(limit, 6) + 1];
+}
 
-// Play the Royal Game of Ur, repeatedly.
-int main(int argc, char *argv[]) {
-    std::cout << "Hello, world! Welcome to the Royal Game of Ur." << std::endl;
+// A block of positions sharing tiles borne off and shared-cell counts.
+struct _RankBlock {
+    Rank offset;
+    uint32_t otherPlacements;  // The ways to place `other` in the leftover shared cells.
+    uint16_t selfPrivate;  // The number of ways to fill `self`'s private cells.
+    uint16_t otherPrivate;
+    uint8_t selfFinished, otherFinished, selfShared, otherShared;
+};
 
-    // Construct some Ur-playing agents.
-    std::unique_ptr<Agent> sam = std::make_unique<InteractiveAgent>("Sam");
-    std::unique_ptr<Agent> farthest = std::make_unique<FarthestAgent>();
-    std::unique_ptr<Agent> closest = std::make_unique<ClosestAgent>();
+constexpr size_t _countRankBlocks() {
+    size_t count = 0;
+    for (int sf = 0; sf <= TILES; ++sf) for (int of = 0; of <= TILES; ++of) {
+        for (int ss = 0; ss <= std::min(8, TILES - sf); ++ss) {
+            count += std::min(8 - ss, TILES - of) + 1;
+        }
+    }
+    return count;
+}
+constexpr size_t RANK_BLOCKS = _countRankBlocks();
 
-    // Play one game against the AI.
-    playOneGame(sam, closest);
+struct _RankTables {
+    std::array<_RankBlock, RANK_BLOCKS + 1> blocks{};  // With a sentinel at the end.
+    // Index into `blocks` by [selfFinished][otherFinished][selfShared][otherShared].
+    uint16_t index[TILES + 1][TILES + 1][9][9]{};
+    // Where each layer (by total tiles borne off) begins.
+    std::array<Rank, 2 * TILES + 2> layers{};
+    // The block containing the first index of every bucket of `1 << shift`
+    // indices, to narrow down the search in `unrank`.
+    std::array<uint16_t, 4096 + 2> buckets{};
+    unsigned shift = 0;
+    // The largest block, to check that local offsets fit in 32 bits.
+    Rank largest = 0;
+};
+constexpr _RankTables _makeRankTables() {
+    _RankTables tables;
+    size_t b = 0;
+    Rank offset = 0;
+    for (int total = 0; total <= 2 * TILES; ++total) {
+        tables.layers[total] = offset;
+        for (int sf = std::max(0, total - TILES); sf <= std::min<int>(total, TILES); ++sf) {
+            int of = total - sf;
+            for (int ss = 0; ss <= std::min(8, TILES - sf); ++ss) {
+                for (int os = 0; os <= std::min(8 - ss, TILES - of); ++os) {
+                    _RankBlock& block = tables.blocks[b];
+                    block.offset = offset;
+                    block.otherPlacements = _binomial(8 - ss, os);
+                    block.selfPrivate = _privateCount(TILES - sf - ss);
+                    block.otherPrivate = _privateCount(TILES - of - os);
+                    block.selfFinished = sf;
+                    block.otherFinished = of;
+                    block.selfShared = ss;
+                    block.otherShared = os;
+                    tables.index[sf][of][ss][os] = b++;
+                    Rank size = _binomial(8, ss) * block.otherPlacements * block.selfPrivate * block.otherPrivate;
+                    tables.largest = std::max(tables.largest, size);
+                    offset += size;
+                }
+            }
+        }
+    }
+    tables.layers[2 * TILES + 1] = offset;
+    tables.blocks[b].offset = offset;
 
-    // Simulate many games between the AIs.
-    size_t repeats = 10000;
-    size_t firstPlayerWins = 0;
-    for (size_t i = 0; i < repeats; ++i) {
-        if (playOneGame(farthest, closest)) {
-            firstPlayerWins++;
+    while (offset >> tables.shift > 4096) tables.shift++;
+    for (size_t bucket = 0, block = 0; bucket < tables.buckets.size(); ++bucket) {
+        while (block < RANK_BLOCKS - 1 && tables.blocks[block + 1].offset <= bucket << tables.shift) {
+            block++;
         }
+        tables.buckets[bucket] = block;
     }
-    std::cout << "First player won " << firstPlayerWins << " / " << repeats << std::endl;
+    return tables;
+}
+constexpr _RankTables RANKING = _makeRankTables();
+static_assert(RANKING.largest <= UINT32_MAX, "Blocks are addressed with 32-bit offsets.");
 
-    return EXIT_SUCCESS;
+// The number of legal positions.
+constexpr Rank RANK_COUNT = RANKING.blocks[RANK_BLOCKS].offset;
+
+// `_compress` and `_expand` for every pair of 8-bit arguments, by [value][mask].
+//
+// At 64KiB each these are too big to build as constexpr under some compilers'
+// default evaluation limits, so they're built once at startup instead.
+using _ByteTable = std::array<std::array<uint8_t, 256>, 256>;
+template <uint32_t (*Function)(uint32_t, uint32_t)>
+_ByteTable _makeByteTable() {
+    _ByteTable table;
+    for (unsigned value = 0; value < 256; ++value) {
+        for (unsigned mask = 0; mask < 256; ++mask) table[value][mask] = Function(value, mask);
+    }
+    return table;
+}
+const _ByteTable COMPRESSED = _makeByteTable<_compress>();
+const _ByteTable EXPANDED = _makeByteTable<_expand>();
+
+// Map a legal position onto [0, RANK_COUNT).
+//
+// Pre: The position is legal. Bit 0 of `occupied` is ignored.
+[[ nodiscard ]] inline Rank rank(uint16_t selfRemaining, uint16_t selfOccupied,
+                                 uint16_t otherRemaining, uint16_t otherOccupied) {
+    unsigned selfShared = selfOccupied >> 5 & 0xFF;
+    unsigned otherShared = otherOccupied >> 5 & 0xFF;
+    unsigned selfPrivate = _privateCells(selfOccupied);
+    unsigned otherPrivate = _privateCells(otherOccupied);
+    unsigned ss = SUBSETS.size[selfShared];
+    unsigned os = SUBSETS.size[otherShared];
+    unsigned sf = TILES - selfRemaining - ss - SUBSETS.size[selfPrivate];
+    unsigned of = TILES - otherRemaining - os - SUBSETS.size[otherPrivate];
+    const _RankBlock& block = RANKING.blocks[RANKING.index[sf][of][ss][os]];
+
+    uint32_t shared = SUBSETS.rank[selfShared] * block.otherPlacements
+                    + SUBSETS.rank[COMPRESSED[otherShared][~selfShared & 0xFF]];
+    uint32_t self = SUBSETS.privateRank[selfPrivate];
+    uint32_t other = SUBSETS.privateRank[otherPrivate];
+    return block.offset + (shared * block.selfPrivate + self) * block.otherPrivate + other;
+}
+[[ nodiscard ]] inline Rank rank(Side self, Side other) {
+    return rank(self.remaining, self.occupied.to_ulong(), other.remaining, other.occupied.to_ulong());
+}
+[[ nodiscard ]] inline Rank rank(GameState state) {
+    return rank(state.bits >> REMAINING_SHIFT & 0xF, state.bits & HALF_OCCUPIED,
+                state.bits >> (REMAINING_SHIFT + 32) & 0xF, state.bits >> 32 & HALF_OCCUPIED);
+}
+
+// The inverse of `rank`.
+//
+// Pre: `index < RANK_COUNT`.
+void unrank(Rank index, Side& self, Side& other) {
+    size_t bucket = index >> RANKING.shift;
+    const _RankBlock* block = std::upper_bound(
+        RANKING.blocks.begin() + RANKING.buckets[bucket],
+        RANKING.blocks.begin() + RANKING.buckets[bucket + 1] + 1, index,
+        [](Rank value, const _RankBlock& b) { return value < b.offset; }) - 1;
+
+    uint32_t local = index - block->offset;
+    unsigned otherPrivate = SUBSETS.privateMask[local % block->otherPrivate];
+    local /= block->otherPrivate;
+    unsigned selfPrivate = SUBSETS.privateMask[local % block->selfPrivate];
+    local /= block->selfPrivate;
+    unsigned selfShared = SUBSETS.mask[SUBSETS.begin[block->selfShared] + local / block->otherPlacements];
+    unsigned otherShared = EXPANDED
+        [SUBSETS.mask[SUBSETS.begin[block->otherShared] + local % block->otherPlacements]]
+        [~selfShared & 0xFF];
+
+    uint16_t selfOccupied = _fromPrivateCells(selfPrivate) | selfShared << 5;
+    uint16_t otherOccupied = _fromPrivateCells(otherPrivate) | otherShared << 5;
+    self.remaining = TILES - block->selfFinished - block->selfShared - SUBSETS.size[selfPrivate];
+    other.remaining = TILES - block->otherFinished - block->otherShared - SUBSETS.size[otherPrivate];
+    self.occupied = selfOccupied | (self.remaining != 0);
+    other.occupied = otherOccupied | (other.remaining != 0);
+}
+[[ nodiscard ]] inline GameState unrank(Rank index, bool firstToMove) {
+    Side self, other;
+    unrank(index, self, other);
+    return pack(self, other, firstToMove);
+}
+
+// Verify that `rank` and `unrank` are inverse bijections on the legal positions.
+//
+// This walks the whole space, so it takes a little while.
+bool _verifyRanking() {
+    // Count the legal positions by brute force: tally the legal sides by their
+    // shared cells, then pair them up wherever the shared cells are disjoint.
+    std::array<uint64_t, 256> sides = {};
+    for (uint16_t occupied = 0; occupied < 0x8000; occupied += 2) {
+        for (uint16_t remaining = 0; remaining <= TILES; ++remaining) {
+            if (__builtin_popcount(occupied) + remaining <= TILES) sides[occupied >> 5 & 0xFF]++;
+        }
+    }
+    uint64_t legal = 0;
+    for (unsigned self = 0; self < 256; ++self) {
+        for (unsigned other = 0; other < 256; ++other) {
+            if ((self & other) == 0) legal += sides[self] * sides[other];
+        }
+    }
+    if (legal != RANK_COUNT) return false;
+
+    // Then check that every index round-trips through a legal position.
+    for (Rank index = 0; index < RANK_COUNT; ++index) {
+        Side self, other;
+        unrank(index, self, other);
+        if (!_verifySides(self, other) || self.remaining > TILES || other.remaining > TILES
+                || finished(self) > TILES || finished(other) > TILES
+                || self.occupied.test(0) != (self.remaining != 0)
+                || other.occupied.test(0) != (other.remaining != 0)
+                || rank(self, other) != index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Verify the packed `getOptions` and `apply` against the `Side` versions for
+// every roll and move from every legal position, with either player to move.
+bool _verifyPackedState() {
+    for (Rank index = 0; index < RANK_COUNT; ++index) {
+        for (bool first : {true, false}) {
+            const GameState state = unrank(index, first);
+            if (!_verifyState(state)) return false;
+            const Side self = selfSide(state), other = otherSide(state);
+            for (Steps steps = 1; steps <= 4; ++steps) {
+                Options options = getOptions(state, steps);
+                if (options != getOptions(self, other, steps)) return false;
+                for (unsigned long bits = options.to_ulong(); bits != 0; bits &= bits - 1) {
+                    Position start = __builtin_ctzl(bits);
+                    GameState next = state;
+                    Side nextSelf = self, nextOther = other;
+                    bool again = apply(next, start, steps);
+                    if (again != apply(nextSelf, nextOther, start, steps).again
+                            || next != pack(nextSelf, nextOther, first) || !_verifyState(next)) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+/***************
+ * MOVE TABLES *
+ ***************/
+
+// The options for every occupancy of `self` (15 bits; bit 15 is never set) and
+// a roll of `S`, as for `getOptions` but before the opponent is considered.
+//
+// The opponent only ever matters through the central rosette, which masks a
+// single bit, so that's left to one AND rather than doubling the table. Each
+// roll gets its own table, so that none is too big to build as constexpr (see
+// `_ByteTable`); at 64KiB apiece they fit in L2 together. A roll of 0 gets a
+// table too (of nothing but zeros), so that it has no options here either.
+template <Steps S>
+constexpr std::array<uint16_t, 0x8000> _makeOptionsTable() {
+    std::array<uint16_t, 0x8000> table{};
+    for (unsigned occupied = 0; occupied < 0x8000; ++occupied) {
+        table[occupied] = occupied & ~(occupied >> S) & 0xFFFF >> S;
+    }
+    return table;
+}
+template <Steps S>
+constexpr std::array<uint16_t, 0x8000> OPTIONS_TABLE = _makeOptionsTable<S>();
+constexpr const uint16_t* OPTIONS_TABLES[5] = {
+    OPTIONS_TABLE<0>.data(), OPTIONS_TABLE<1>.data(), OPTIONS_TABLE<2>.data(), OPTIONS_TABLE<3>.data(), OPTIONS_TABLE<4>.data(),
+};
+
+// What a move from each start and for each roll does to a packed state (see
+// `apply(GameState&, ...)`), which doesn't depend on the rest of the state.
+struct _MoveEffect {
+    uint64_t take;  // Subtracted to pick up the piece: a tile from the pile, or its bit.
+    uint64_t place;  // Set to put it down, unless it's borne off.
+    uint64_t hit;  // The opponent's bit at the end, if it can be captured there.
+    bool again;  // Whether the move ends on a rosette.
+};
+using _MoveTable = std::array<std::array<_MoveEffect, 5>, 16>;
+constexpr _MoveTable _makeMoveTable() {
+    _MoveTable table{};
+    for (Position start = 0; start < 15; ++start) {
+        for (Steps steps = 1; steps <= 4; ++steps) {
+            Position end = start + steps;
+            _MoveEffect& effect = table[start][steps];
+            effect.take = start == 0 ? uint64_t{1} << REMAINING_SHIFT : uint64_t{1} << start;
+            effect.place = end < 15 ? uint64_t{1} << end : 0;
+            effect.hit = 5 <= end && end <= 12 ? uint64_t{1} << (end + 32) : 0;
+            effect.again = end == 4 || end == 8 || end == 14;
+        }
+    }
+    return table;
+}
+constexpr _MoveTable MOVE_TABLE = _makeMoveTable();
+
+
+// `getOptions(GameState, Steps)` by table lookup.
+[[ nodiscard ]] inline Options lookupOptions(GameState state, Steps steps) {
+    return Options{OPTIONS_TABLES[steps][state.bits & 0x7FFF] & ~(state.bits >> 32 & 0x0100)};
+}
+
+// `apply(GameState&, Position, Steps)` by table lookup, without branches.
+//
+// Pre: The proposed move is valid.
+[[ nodiscard ]] inline bool lookupApply(GameState& state, Position start, Steps steps) {
+    const _MoveEffect& effect = MOVE_TABLE[start][steps];
+    uint64_t bits = state.bits - effect.take;
+    bits &= ~uint64_t{(bits & HALF_REMAINING) == 0};  // The pile is empty.
+    bits |= effect.place;
+    uint64_t hit = bits & effect.hit;
+    uint64_t captured = hit != 0;
+    bits ^= hit;
+    bits += captured << (REMAINING_SHIFT + 32);
+    bits |= captured << 32;
+    state.bits = bits;
+    return effect.again;
+}
+
+
+// Check the tables against `getOptions` and `apply` for every roll and move
+// from every legal position, and for every occupancy besides.
+bool _verifyMoveTables() {
+    for (uint64_t occupied = 0; occupied < 0x8000; ++occupied) {
+        for (uint64_t rosette : {uint64_t{0}, uint64_t{0x0100}}) {
+            GameState state{occupied | (occupied & 1) << REMAINING_SHIFT | rosette << 32};
+            for (Steps steps = 0; steps <= 4; ++steps) {
+                if (lookupOptions(state, steps) != getOptions(unpackSide(state.bits), unpackSide(state.bits >> 32), steps)) {
+                    return false;
+                }
+            }
+        }
+    }
+    for (Rank index = 0; index < RANK_COUNT; ++index) {
+        const GameState state = unrank(index, true);
+        for (Steps steps = 1; steps <= 4; ++steps) {
+            Options options = getOptions(state, steps);
+            if (lookupOptions(state, steps) != options) return false;
+            for (unsigned long bits = options.to_ulong(); bits != 0; bits &= bits - 1) {
+                GameState expected = state, actual = state;
+                bool again = apply(expected, __builtin_ctzl(bits), steps);
+                if (lookupApply(actual, __builtin_ctzl(bits), steps) != again || actual.bits != expected.bits) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+/***********
+ * BATCHES *
+ ***********/
+
+// Move generation over many positions at once, given as structure-of-arrays:
+// `self[i]` and `other[i]` are the occupancies of position i (as in
+// `Side::occupied`). The piles don't matter beyond bit 0, so they're left out.
+//
+// The kernels are picked at runtime by what the CPU supports, so the binary
+// still runs (if slower) on one that lacks AVX2.
+
+enum class BatchIsa { Scalar, Sse2, Avx2 };
+
+[[ nodiscard ]] const char* batchIsaName(BatchIsa isa) {
+    switch (isa) {
+    case BatchIsa::Scalar: return "scalar";
+    case BatchIsa::Sse2: return "SSE2";
+    default: return "AVX2";
+    }
+}
+
+// The best kernels this CPU can run.
+[[ nodiscard ]] BatchIsa bestBatchIsa() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? BatchIsa::Avx2 : BatchIsa::Sse2;
+#else
+    return BatchIsa::Scalar;
+#endif
+}
+const BatchIsa BATCH_ISA = bestBatchIsa();
+
+// `getOptions` on bare occupancies, which every kernel falls back on for the
+// positions left over after the last full vector.
+[[ nodiscard ]] inline uint16_t _batchOptions(uint16_t self, uint16_t other, unsigned steps) {
+    unsigned occupied = self & 0x7FFF;
+    return occupied & ~(occupied >> steps) & ~(other & 0x0100u) & 0xFFFFu >> steps;
+}
+
+#if defined(__x86_64__)
+// Eight positions per 128-bit vector, in 16-bit lanes. Every x86-64 has SSE2.
+void _getOptionsBatchSse2(const uint16_t* self, const uint16_t* other, Steps steps,
+                          uint16_t* options, size_t count) {
+    const __m128i shift = _mm_cvtsi32_si128(steps);
+    const __m128i path = _mm_set1_epi16(0x7FFF);
+    const __m128i rosette = _mm_set1_epi16(0x0100);
+    const __m128i board = _mm_set1_epi16(int16_t(0xFFFF >> steps));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i occupied = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(self + i)), path);
+        __m128i blocked = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(other + i)), rosette);
+        __m128i result = _mm_andnot_si128(_mm_srl_epi16(occupied, shift), occupied);
+        result = _mm_and_si128(_mm_andnot_si128(blocked, result), board);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(options + i), result);
+    }
+    for (; i < count; ++i) options[i] = _batchOptions(self[i], other[i], steps);
+}
+
+// Sixteen positions per 256-bit vector, in 16-bit lanes.
+__attribute__((target("avx2")))
+void _getOptionsBatchAvx2(const uint16_t* self, const uint16_t* other, Steps steps,
+                          uint16_t* options, size_t count) {
+    const __m128i shift = _mm_cvtsi32_si128(steps);
+    const __m256i path = _mm256_set1_epi16(0x7FFF);
+    const __m256i rosette = _mm256_set1_epi16(0x0100);
+    const __m256i board = _mm256_set1_epi16(int16_t(0xFFFF >> steps));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i occupied = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(self + i)), path);
+        __m256i blocked = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(other + i)), rosette);
+        __m256i result = _mm256_andnot_si256(_mm256_srl_epi16(occupied, shift), occupied);
+        result = _mm256_and_si256(_mm256_andnot_si256(blocked, result), board);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(options + i), result);
+    }
+    for (; i < count; ++i) options[i] = _batchOptions(self[i], other[i], steps);
+}
+
+// Eight positions per vector, each with its own roll. There are no variable
+// 16-bit shifts before AVX-512, so this widens to 32-bit lanes.
+__attribute__((target("avx2")))
+void _getOptionsBatchAvx2(const uint16_t* self, const uint16_t* other, const Steps* steps,
+                          uint16_t* options, size_t count) {
+    const __m256i path = _mm256_set1_epi32(0x7FFF);
+    const __m256i rosette = _mm256_set1_epi32(0x0100);
+    const __m256i board = _mm256_set1_epi32(0xFFFF);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i occupied = _mm256_and_si256(
+            _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(self + i))), path);
+        __m256i blocked = _mm256_and_si256(
+            _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(other + i))), rosette);
+        __m256i shift = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(steps + i)));
+        __m256i result = _mm256_andnot_si256(_mm256_srlv_epi32(occupied, shift), occupied);
+        result = _mm256_and_si256(_mm256_andnot_si256(blocked, result), _mm256_srlv_epi32(board, shift));
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(options + i), packed);
+    }
+    for (; i < count; ++i) options[i] = _batchOptions(self[i], other[i], steps[i]);
+}
+#endif
+
+// Fill `options[i]` with the options of position i for a roll of `steps`
+// (which may be 0, for no options), for each of `count` positions.
+//
+// Without a kernel, this is a plain loop over the positions. It's inline, so
+// that the loop is compiled where it's called, like a caller's own loop over
+// `getOptions`, and `ivdep` tells the compiler that `options` may only overlap
+// the inputs position for position. Out of line, the compiler gave up on
+// vectorizing it, and it ran at half the speed of one `getOptions` at a time.
+inline void getOptionsBatch(const uint16_t* self, const uint16_t* other, Steps steps,
+                            uint16_t* options, size_t count, BatchIsa isa = BATCH_ISA) {
+#if defined(__x86_64__)
+    if (isa == BatchIsa::Avx2) return _getOptionsBatchAvx2(self, other, steps, options, count);
+    if (isa == BatchIsa::Sse2) return _getOptionsBatchSse2(self, other, steps, options, count);
+#endif
+#pragma GCC ivdep
+    for (size_t i = 0; i < count; ++i) options[i] = _batchOptions(self[i], other[i], steps);
+}
+
+// The same, but position i has a roll of `steps[i]`. Only AVX2 has a kernel
+// for this, since there are no variable 16-bit shifts to vectorize it with.
+inline void getOptionsBatch(const uint16_t* self, const uint16_t* other, const Steps* steps,
+                            uint16_t* options, size_t count, BatchIsa isa = BATCH_ISA) {
+#if defined(__x86_64__)
+    if (isa == BatchIsa::Avx2) return _getOptionsBatchAvx2(self, other, steps, options, count);
+#endif
+#pragma GCC ivdep
+    for (size_t i = 0; i < count; ++i) options[i] = _batchOptions(self[i], other[i], steps[i]);
+}
+
+
+// Check every kernel this CPU can run against `getOptions`, for every
+// occupancy of `self` and every roll, with and without the central rosette
+// taken (and junk in the rest of `other`, which must be ignored).
+bool _verifyOptionsBatch() {
+    const size_t count = 2 * 0x8000 - 3;  // Not a whole number of vectors.
+    std::vector<uint16_t> self(count), other(count), options(count);
+    std::vector<Steps> steps(count);
+    for (size_t i = 0; i < count; ++i) {
+        self[i] = i & 0x7FFF;
+        other[i] = (i & 0x8000 ? 0x0100 : 0) | (i * 0x9E37 & 0xFEFE);
+        steps[i] = i % 5;
+    }
+    auto expected = [&](size_t i, Steps roll) {
+        Side selfSide{uint16_t(self[i] & 1), self[i]}, otherSide{0, other[i] & 0x7FFF};
+        return roll == 0 ? 0 : getOptions(selfSide, otherSide, roll).to_ulong();
+    };
+    for (BatchIsa isa : {BatchIsa::Scalar, BatchIsa::Sse2, BatchIsa::Avx2}) {
+        if (isa > BATCH_ISA) break;
+        for (Steps roll = 0; roll <= 4; ++roll) {
+            getOptionsBatch(self.data(), other.data(), roll, options.data(), count, isa);
+            for (size_t i = 0; i < count; ++i) if (options[i] != expected(i, roll)) return false;
+        }
+        getOptionsBatch(self.data(), other.data(), steps.data(), options.data(), count, isa);
+        for (size_t i = 0; i < count; ++i) if (options[i] != expected(i, steps[i])) return false;
+    }
+    return true;
+}
+
+
+/**********
+ * AGENTS *
+ **********/
+
+// An abstract agent for Ur.
+//
+// A concrete subclass must override `getMove(...)`. If an implementation wants
+// to signal a failure, it should return `INVALID`.
+//
+// An agent should be constructed with a name, although subclasses can choose to
+// provide a default name.
+class Agent {
+public:
+    Agent(std::string name) : _name(name) { /* empty */ }
+    virtual ~Agent() { /* empty */ };
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) = 0;
+    [[ nodiscard ]] std::string getName() const { return _name; }
+
+    static constexpr Position INVALID{15};  // It's invalid to move from spot 15.
+protected:
+    std::string _name;
+};
+
+
+// A concrete agent that advances the piece farthest from the end.
+class FarthestAgent final : public Agent {
+public:
+    FarthestAgent() : Agent("Furthest") { /* empty */ }
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
+        for (size_t i = 0; i < 15; ++i) {
+            if (options.test(i)) return i;
+        }
+        return INVALID;
+    }
+};
+
+
+// A concrete agent that advances the piece closest to the end.
+class ClosestAgent final : public Agent {
+public:
+    ClosestAgent() : Agent("Closest") { /* empty */ }
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
+        for (int i = 14; i >= 0; --i) {  // Needs to be int, not size_t.
+            if (options.test(i)) return i;
+        }
+        return INVALID;
+    }
+};
+
+
+// A concrete agent that asks the user to choose from among available options.
+class InteractiveAgent : public Agent {
+public:
+    InteractiveAgent(std::string name) : Agent(name) { /* empty */}
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
+        std::cout << "Hello, " << _name << "!" << std::endl;
+        std::cout << "The current state (you are shown on top) is: " << std::endl;
+        display(self, other);
+        std::cout << "You rolled a " << +steps << "." << std::endl;
+        std::cout << "Your options are: " << std::endl;
+        for (size_t i = 0; i < 15; ++i) {
+            if (options.test(i)) std::cout << "> " << i << std::endl;
+        }
+        // Read the user's input.
+        std::cout << "What do you choose? ";
+        std::cout.flush();
+        uint16_t move = INVALID;  // Be wary of implicit widening and narrowing.
+        while (true) {
+            std::string line;
+            if (!getline(std::cin, line)) {
+                std::cerr << "Unexpected end of input." << std::endl;
+            }
+            // Ideally, I'd also trim the line.
+            std::istringstream stream(line);
+            stream >> move;
+            if (stream.fail() || !stream.eof()) {
+                std::cerr << "Illegal format." << std::endl;
+                std::cout << "Please try again: ";
+                std::cout.flush();
+                continue;
+            }
+            if (!options[move]) {
+                std::cerr << "Invalid option." << std::endl;
+                std::cout << "Please try again: ";
+                std::cout.flush();
+                continue;
+            }
+            break;
+        }
+        return move;
+    }
+};
+
+
+/************
+ * GAMEPLAY *
+ ************/
+
+// The agent behind `player`, which is either an agent or a pointer to one.
+template <typename Player>
+inline Player& _agent(Player& player) { return player; }
+template <typename A>
+inline A& _agent(std::unique_ptr<A>& player) { return *player; }
+template <typename A>
+inline A& _agent(const std::unique_ptr<A>& player) { return *player; }
+
+// Hears about everything that happens in a game, as it's played (see
+// `playOneGame`). Every hook here does nothing: an observer derives from this
+// and hides just the hooks it wants. They're called statically, so whatever an
+// observer doesn't hear about costs nothing, and `NullObserver` itself compiles
+// away entirely.
+//
+// `first` always says whether it's the first player's doing.
+struct NullObserver {
+    void gameStarted(const Agent& first, const Agent& second) { /* empty */ }
+    // Before every roll, with the first player's side and the second's.
+    void turnStarted(Side firstSide, Side secondSide, bool first) { /* empty */ }
+    void rolled(bool first, Steps steps) { /* empty */ }
+    // Only for rolls other than 0.
+    void optionsFound(bool first, Options options) { /* empty */ }
+    // Whatever the agent asked for, which may be invalid (and so pass the turn).
+    void moveChosen(bool first, Position start, bool valid) { /* empty */ }
+    void captured(bool first, Position end) { /* empty */ }
+    void extraTurn(bool first) { /* empty */ }
+    void gameEnded(bool firstWon, uint64_t rolls) { /* empty */ }
+};
+
+// Print a game to `std::cout` as it's played, a line per event.
+class ConsoleObserver : public NullObserver {
+public:
+    void gameStarted(const Agent& first, const Agent& second) {
+        _names = {first.getName(), second.getName()};
+    }
+    void turnStarted(Side firstSide, Side secondSide, bool first) { display(firstSide, secondSide); }
+    void rolled(bool first, Steps steps) {
+        std::cout << _name(first) << " rolls a " << +steps << "." << std::endl;
+    }
+    void optionsFound(bool first, Options options) {
+        if (options.none()) std::cout << "No legal moves." << std::endl;
+    }
+    void moveChosen(bool first, Position start, bool valid) {
+        std::cout << _name(first) << " chooses " << +start << "." << std::endl;
+        if (!valid) std::cout << "Oh no! An invalid move..." << std::endl;
+    }
+    void captured(bool first, Position end) {
+        std::cout << _name(first) << " captures at " << +end << "!" << std::endl;
+    }
+    void extraTurn(bool first) { std::cout << _name(first) << " goes again." << std::endl; }
+    void gameEnded(bool firstWon, uint64_t rolls) {
+        std::cout << "Ended after " << rolls << " rolls." << std::endl;
+    }
+
+private:
+    const std::string& _name(bool first) const { return first ? _names[0] : _names[1]; }
+
+    std::array<std::string, 2> _names;
+};
+
+template <typename T>
+constexpr bool _isObserver = std::is_base_of_v<NullObserver, std::decay_t<T>>;
+
+
+// Play out one roll and return whether the current player goes again.
+//
+// The player is either a `std::unique_ptr<Agent>`, whose moves go through the
+// vtable (e.g. for `InteractiveAgent`), or a concrete agent such as
+// `FarthestAgent`, whose `getMove` can then be inlined into the game loop.
+// `first` says whether it's the first player, for the observer.
+template <typename Player, typename Roller, typename Observer>
+bool playOneRoll(Player& player, Side& self, Side& other, Roller& dice, Observer& observer, bool first) {
+    // Roll the tetrahedra to determine the number of steps.
+    Steps steps = dice.roll();
+    observer.rolled(first, steps);
+
+    // Don't bother asking the agent for a move if the roll was a zero.
+    if (steps == 0) return false;
+
+    // Precompute the valid moves. Sometimes there are none, so we move on.
+    //
+    // This stays on the runtime roll: the roll is random, so switching on it to
+    // reach `getOptions<S>` mispredicts far more than a variable shift costs.
+    Options options = getOptions(self, other, steps);
+    observer.optionsFound(first, options);
+    if (options == 0) return false;
+
+    // Ask the agent for a move. Submitting an invalid move passes your turn.
+    Position start = _agent(player).getMove(self, other, steps, options);
+    bool valid = start != Agent::INVALID && options[start];
+    observer.moveChosen(first, start, valid);
+    if (!valid) return false;
+
+    // Apply the move to the game state.
+    Undo move = apply(self, other, start, steps);
+    if (move.captured) observer.captured(first, move.end);
+    if (move.again) observer.extraTurn(first);
+    return move.again;
+}
+
+
+// Play one game of Ur, each player rolling their own dice, and return whether
+// the first player won. The same dice (e.g. `Dice(seed, game)`) always give the
+// same game between the same (deterministic) agents. The players are as for
+// `playOneRoll`.
+//
+// Pass an observer (e.g. `ConsoleObserver()`) to watch the game; by default,
+// nobody does, and it's played as fast as if there were no hooks at all.
+template <typename First, typename Second, typename FirstRoller, typename SecondRoller,
+          typename Observer = NullObserver, typename = std::enable_if_t<!_isObserver<SecondRoller>>>
+bool playOneGame(First& first, Second& second, FirstRoller&& firstDice, SecondRoller&& secondDice,
+                 Observer&& observer = Observer()) {
+    Side left = START;
+    Side right = START;
+    observer.gameStarted(_agent(first), _agent(second));
+
+    uint64_t rolls = 0;  // Track the length of the game.
+    bool current = true;  // Whether the current player is the first player.
+    while (left != COMPLETE && right != COMPLETE) {
+        observer.turnStarted(left, right, current);
+
+        // The current player's side is `self`; the opponent's side is `other`.
+        Side& self = current ? left : right;
+        Side& other = current ? right : left;
+
+        // Let the current player play out a roll.
+        bool again = current ? playOneRoll(first, self, other, firstDice, observer, true)
+                             : playOneRoll(second, self, other, secondDice, observer, false);
+        ++rolls;
+        current = !(current ^ again);
+    }
+    observer.gameEnded(left == COMPLETE, rolls);
+    return left == COMPLETE;
+}
+
+// Play one game of Ur, both players rolling the same dice.
+template <typename First, typename Second, typename Roller, typename Observer = NullObserver,
+          typename = std::enable_if_t<_isObserver<Observer>>>
+bool playOneGame(First& first, Second& second, Roller&& dice, Observer&& observer = Observer()) {
+    return playOneGame(first, second, dice, dice, observer);
+}
+
+
+/***********
+ * LOGGING *
+ ***********/
+
+// Log every game of a tournament without slowing it down much: each playing
+// thread appends compact binary events to its own lock-free ring, and a
+// background thread drains the rings to a text or binary sink. Nothing is
+// formatted, locked or flushed on the playing threads.
+
+// An event, packed into 8 bytes (this is also the binary log format): its kind
+// in bits 0..1, whether it was the first player's doing in bit 2, and a value
+// in the rest. Each thread plays a game at a time, so its events come a game at
+// a time too, and only `GameStarted` names the game (its value). Everything
+// that happens on a roll is folded into one `Roll`, and `GameEnded` holds the
+// length of the game, `first` saying who won.
+//
+// The threads' events are interleaved in the log, so a binary log is a series
+// of runs from one thread at a time, each led by a `Frame` whose value holds
+// the thread's writer (from 0, in the upper bits) and the length of the run
+// (in the lower 32 bits). See `readGameLog`.
+struct LogEvent {
+    enum Kind : uint8_t { GameStarted, Roll, GameEnded, Frame };
+
+    // The fields of a `Roll`'s value. Options are only found for a nonzero
+    // roll, and a move is only chosen if there were any.
+    static constexpr unsigned STEPS_SHIFT = 0;  // 3 bits.
+    static constexpr unsigned OPTIONS_SHIFT = 3;  // 16 bits.
+    static constexpr unsigned START_SHIFT = 19;  // 4 bits.
+    static constexpr uint64_t CHOSEN = 1 << 23, VALID = 1 << 24, CAPTURED = 1 << 25, AGAIN = 1 << 26;
+
+    uint64_t bits;
+
+    [[ nodiscard ]] static constexpr LogEvent make(Kind kind, bool first, uint64_t value) {
+        return LogEvent{kind | uint64_t{first} << 2 | value << 3};
+    }
+    [[ nodiscard ]] constexpr Kind kind() const { return Kind(bits & 0x3); }
+    [[ nodiscard ]] constexpr bool first() const { return bits >> 2 & 1; }
+    [[ nodiscard ]] constexpr uint64_t value() const { return bits >> 3; }
+};
+
+
+// A ring of events with a single producer (a playing thread) and a single
+// consumer (the drain thread), neither of which ever takes a lock. The two
+// ends live on separate cache lines, and the producer only looks at the
+// consumer's end when the ring seems to be full.
+class _LogRing {
+public:
+    // Pre: `capacity` is a power of 2.
+    explicit _LogRing(size_t capacity) : _events(capacity), _mask(capacity - 1) { /* empty */ }
+
+    // Append an event, waiting for the drain thread if the ring is full.
+    void push(LogEvent event) {
+        const uint64_t head = _head.load(std::memory_order_relaxed);
+        while (head - _tailSeen == _events.size()) {
+            _tailSeen = _tail.load(std::memory_order_acquire);
+            if (head - _tailSeen == _events.size()) {
+                _stalls.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+        _events[head & _mask] = event;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    // Pass every event appended so far to `sink(events, count)`, in at most
+    // two runs, then free their room. Returns how many there were.
+    template <typename Sink>
+    uint64_t drain(Sink&& sink) {
+        const uint64_t tail = _tail.load(std::memory_order_relaxed);
+        const uint64_t head = _head.load(std::memory_order_acquire);
+        const uint64_t begin = tail & _mask, count = head - tail;
+        const uint64_t wrap = std::min(count, _events.size() - begin);
+        if (wrap > 0) sink(_events.data() + begin, wrap);
+        if (count > wrap) sink(_events.data(), count - wrap);
+        _tail.store(head, std::memory_order_release);
+        return count;
+    }
+
+    // How many times the producer found the ring full.
+    [[ nodiscard ]] uint64_t stalls() const { return _stalls.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<LogEvent> _events;
+    const uint64_t _mask;
+
+    alignas(64) std::atomic<uint64_t> _head{0};  // Written by the producer...
+    uint64_t _tailSeen = 0;  // ...which remembers where it last saw the tail.
+    std::atomic<uint64_t> _stalls{0};
+    alignas(64) std::atomic<uint64_t> _tail{0};  // Written by the consumer.
+};
+
+
+enum class LogFormat { Text, Binary };
+
+// Log games to `out`, as text (a line per event) or as raw `LogEvent`s.
+//
+// Each playing thread asks for its own `writer()`, an observer to pass to
+// `playOneGame`. A background thread drains every writer's ring until
+// `close()` (or destruction), which writes out whatever is left first.
+class GameLog {
+public:
+    class Writer;
+
+    GameLog(std::ostream& out, LogFormat format, size_t capacity = 1 << 16)
+        : _out(out), _format(format), _capacity(capacity), _drainer([this] { _drain(); }) { /* empty */ }
+    ~GameLog() { close(); }
+    GameLog(const GameLog&) = delete;
+    GameLog& operator=(const GameLog&) = delete;
+
+    // A writer for one thread, with its own ring. It must not outlive the log.
+    [[ nodiscard ]] std::unique_ptr<Writer> writer();
+
+    // Stop the drain thread, after it's written every event logged so far.
+    // Pre: no writer is still logging.
+    void close() {
+        if (!_drainer.joinable()) return;
+        _stop.store(true, std::memory_order_release);
+        _drainer.join();
+        _out.flush();
+    }
+
+    // How many events were written, and how many times a writer had to wait
+    // for room in its ring. Only meaningful after `close()`.
+    [[ nodiscard ]] uint64_t events() const { return _events; }
+    [[ nodiscard ]] uint64_t stalls() const {
+        uint64_t stalls = 0;
+        for (const auto& ring : _rings) stalls += ring->stalls();
+        return stalls;
+    }
+
+private:
+    void _drain() {
+        std::vector<_LogRing*> rings;
+        std::vector<uint64_t> games;  // The game each ring is in the middle of.
+        for (;;) {
+            // Read this first: any event logged before `close()` is then
+            // certain to be seen by the pass below.
+            const bool stopping = _stop.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (size_t i = rings.size(); i < _rings.size(); ++i) rings.push_back(_rings[i].get());
+            }
+            games.resize(rings.size());
+            uint64_t drained = 0;
+            for (size_t i = 0; i < rings.size(); ++i) {
+                drained += rings[i]->drain([&](const LogEvent* events, size_t count) {
+                    _write(i, games[i], events, count);
+                });
+            }
+            _events += drained;
+            if (drained == 0) {
+                if (stopping) break;
+                // A ring holds a few milliseconds of games, so there's no need to
+                // wake up more often (and take the core from a playing thread).
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    // Write a run of events from the ring numbered `ring`, which is in the
+    // middle of `game` (as far as the text shows).
+    void _write(uint64_t ring, uint64_t& game, const LogEvent* events, size_t count) {
+        if (_format == LogFormat::Binary) {
+            // A run is at most a ring's worth, which fits the frame easily.
+            const LogEvent frame = LogEvent::make(LogEvent::Frame, false, ring << 32 | count);
+            _out.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+            _out.write(reinterpret_cast<const char*>(events), count * sizeof(LogEvent));
+            return;
+        }
+        _text.clear();
+        for (size_t i = 0; i < count; ++i) {
+            const LogEvent event = events[i];
+            if (event.kind() == LogEvent::GameStarted) game = event.value();
+            _number(game);
+            const char* who = event.first() ? " first" : " second";
+            const uint64_t value = event.value();
+            switch (event.kind()) {
+            case LogEvent::GameStarted: _text += " starts"; break;
+            case LogEvent::Roll:
+                _text.append(who).append(" rolls ");
+                _number(value >> LogEvent::STEPS_SHIFT & 0x7);
+                if (uint64_t options = value >> LogEvent::OPTIONS_SHIFT & 0xFFFF; options != 0) {
+                    _text += ", can move from";
+                    for (; options != 0; options &= options - 1) {
+                        _text += ' ';
+                        _number(__builtin_ctzll(options));
+                    }
+                }
+                if (value & LogEvent::CHOSEN) {
+                    _text += ", moves from ";
+                    _number(value >> LogEvent::START_SHIFT & 0xF);
+                    if (!(value & LogEvent::VALID)) _text += " (invalid)";
+                }
+                if (value & LogEvent::CAPTURED) _text += ", captures";
+                if (value & LogEvent::AGAIN) _text += ", goes again";
+                break;
+            case LogEvent::GameEnded:
+                _text.append(who).append(" wins after ");
+                _number(value);
+                _text += " rolls";
+                break;
+            case LogEvent::Frame: break;  // Never in a ring.
+            }
+            _text += '\n';
+        }
+        _out.write(_text.data(), _text.size());
+    }
+
+    void _number(uint64_t value) {
+        char digits[20];
+        size_t i = sizeof(digits);
+        do digits[--i] = '0' + value % 10; while ((value /= 10) != 0);
+        _text.append(digits + i, sizeof(digits) - i);
+    }
+
+    std::ostream& _out;
+    const LogFormat _format;
+    const size_t _capacity;
+    std::mutex _mutex;  // Guards `_rings`, which only ever grows.
+    std::vector<std::unique_ptr<_LogRing>> _rings;
+    std::atomic<bool> _stop{false};
+    uint64_t _events = 0;
+    std::string _text;  // The drain thread's buffer for formatting.
+    std::thread _drainer;  // Last, so that it starts once the rest is ready.
+};
+
+// An observer that logs a game to one ring of a `GameLog`, as the game number
+// set by `game()`. A roll's hooks fill in one `Roll` event, which is only
+// pushed when the next roll (or the end of the game) shows it's complete.
+class GameLog::Writer : public NullObserver {
+public:
+    explicit Writer(_LogRing& ring) : _ring(ring) { /* empty */ }
+
+    // Set the number of the next game to be played.
+    Writer& game(uint64_t game) {
+        _game = game;
+        return *this;
+    }
+
+    void gameStarted(const Agent& first, const Agent& second) {
+        _ring.push(LogEvent::make(LogEvent::GameStarted, false, _game));
+    }
+    void rolled(bool first, Steps steps) {
+        if (_rolling) _ring.push(_roll);
+        _roll = LogEvent::make(LogEvent::Roll, first, uint64_t{steps} << LogEvent::STEPS_SHIFT);
+        _rolling = true;
+    }
+    void optionsFound(bool first, Options options) {
+        _set(options.to_ulong() << LogEvent::OPTIONS_SHIFT);
+    }
+    void moveChosen(bool first, Position start, bool valid) {
+        _set(uint64_t{start} << LogEvent::START_SHIFT | LogEvent::CHOSEN | (valid ? LogEvent::VALID : 0));
+    }
+    void captured(bool first, Position end) { _set(LogEvent::CAPTURED); }
+    void extraTurn(bool first) { _set(LogEvent::AGAIN); }
+    void gameEnded(bool firstWon, uint64_t rolls) {
+        if (_rolling) _ring.push(_roll);
+        _rolling = false;
+        _ring.push(LogEvent::make(LogEvent::GameEnded, firstWon, rolls));
+    }
+
+private:
+    void _set(uint64_t value) { _roll.bits |= value << 3; }
+
+    _LogRing& _ring;
+    uint64_t _game = 0;
+    LogEvent _roll{0};  // The roll being played, if `_rolling`.
+    bool _rolling = false;
+};
+
+std::unique_ptr<GameLog::Writer> GameLog::writer() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rings.push_back(std::make_unique<_LogRing>(_capacity));
+    return std::make_unique<Writer>(*_rings.back());
+}
+
+
+// Read back a binary log, calling `f(game, event)` for every event (besides the
+// frames) with the game it belongs to, in the order each thread logged them.
+// Returns whether the log was well-formed, stopping at the first sign it isn't.
+template <typename Function>
+bool readGameLog(std::istream& in, Function&& f) {
+    std::vector<uint64_t> games;  // The game each writer is in the middle of, plus 1 (0 for none yet).
+    LogEvent event;
+    while (in.read(reinterpret_cast<char*>(&event), sizeof(event))) {
+        if (event.kind() != LogEvent::Frame) return false;
+        const uint64_t writer = event.value() >> 32;
+        if (writer >= games.size()) games.resize(writer + 1, 0);
+        for (uint64_t count = event.value() & 0xFFFFFFFF; count > 0; --count) {
+            if (!in.read(reinterpret_cast<char*>(&event), sizeof(event)) || event.kind() == LogEvent::Frame) {
+                return false;
+            }
+            if (event.kind() == LogEvent::GameStarted) games[writer] = event.value() + 1;
+            if (games[writer] == 0) return false;
+            f(games[writer] - 1, event);
+        }
+    }
+    return in.gcount() == 0;  // Not cut off in the middle of an event.
+}
+
+
+/*************
+ * TABLEBASE *
+ *************/
+
+// A tablebase holds the value of every position, indexed by `rank`.
+//
+// On disk, it's a fixed header followed by one uint16_t per position, in native
+// byte order, where a value `v` is stored as round(v * TABLEBASE_SCALE). That's
+// accurate to within 1e-5, which is plenty to pick a move.
+//
+// The file is mapped read-only and is never parsed or copied, so opening it is
+// instant and every process on a box shares the same page cache.
+//
+// A policy table (see `PolicyAgent`) is laid out the same way, with its own
+// magic, but each entry holds a move for each roll rather than a value.
+struct TablebaseHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tiles;  // The value of `TILES` it was solved for.
+    uint64_t count;  // The number of positions, i.e. `RANK_COUNT`.
+    uint64_t reserved;
+};
+constexpr char TABLEBASE_MAGIC[8] = {'U', 'R', 'T', 'A', 'B', 'L', 'E', '\0'};
+constexpr char POLICY_MAGIC[8] = {'U', 'R', 'P', 'O', 'L', 'I', 'C', 'Y'};
+constexpr uint32_t TABLEBASE_VERSION = 1;
+constexpr float TABLEBASE_SCALE = 65535;
+
+
+// Writes a tablebase to disk, a range of positions at a time.
+//
+// Ranges can be written in any order, so a solver can stream each part of the
+// table out as soon as it's final. They go to `path` + ".tmp", which only
+// replaces `path` on `commit()`: until every range is written, the header is
+// already valid and the unwritten ranges read as zeros, so a half-written
+// table mustn't be mistaken for a finished one. Without a commit, the
+// temporary file is removed.
+class TablebaseWriter {
+public:
+    explicit TablebaseWriter(const std::string& path, const char (&magic)[8] = TABLEBASE_MAGIC)
+        : _path(path), _temporary(path + ".tmp"), _out(_temporary, std::ios::binary) {
+        TablebaseHeader header{};
+        std::copy(std::begin(magic), std::end(magic), header.magic);
+        header.version = TABLEBASE_VERSION;
+        header.tiles = TILES;
+        header.count = RANK_COUNT;
+        _out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        _check();
+    }
+    ~TablebaseWriter() {
+        if (_committed) return;
+        _out.close();
+        std::remove(_temporary.c_str());
+    }
+    TablebaseWriter(const TablebaseWriter&) = delete;
+    TablebaseWriter& operator=(const TablebaseWriter&) = delete;
+
+    explicit operator bool() const { return bool(_out); }
+
+    // Move the finished table into place, once every range has been written.
+    bool commit() {
+        _out.close();
+        if (!_check()) return false;
+        if (std::rename(_temporary.c_str(), _path.c_str()) != 0) {
+            std::cerr << "Failed to rename " << _temporary << " to " << _path << "." << std::endl;
+            return false;
+        }
+        return _committed = true;
+    }
+
+    // Write the positions in [begin, end), where `value(index)` gives each one.
+    template <typename Lookup>
+    bool write(Rank begin, Rank end, Lookup&& value) {
+        return writeEntries(begin, end, [&](Rank index) -> uint16_t {
+            return std::lround(value(index) * TABLEBASE_SCALE);
+        });
+    }
+
+    // Write the raw entries in [begin, end), where `entry(index)` gives each one.
+    template <typename Lookup>
+    bool writeEntries(Rank begin, Rank end, Lookup&& entry) {
+        _out.seekp(sizeof(TablebaseHeader) + begin * sizeof(uint16_t));
+        std::vector<uint16_t> buffer(1 << 20);
+        for (Rank chunk = begin; chunk < end && _out; chunk += buffer.size()) {
+            Rank stop = std::min<Rank>(end, chunk + buffer.size());
+            for (Rank index = chunk; index < stop; ++index) buffer[index - chunk] = entry(index);
+            _out.write(reinterpret_cast<const char*>(buffer.data()), (stop - chunk) * sizeof(uint16_t));
+        }
+        return _check();
+    }
+
+private:
+    bool _check() {
+        if (!_out) std::cerr << "Failed to write " << _path << "." << std::endl;
+        return bool(_out);
+    }
+
+    std::string _path;
+    std::string _temporary;
+    std::ofstream _out;
+    bool _committed = false;
+};
+
+
+// A read-only view of a tablebase file.
+//
+// If the file is missing or doesn't match this build, the reason is printed
+// and the tablebase converts to false.
+class Tablebase {
+public:
+    explicit Tablebase(const std::string& path, const char (&magic)[8] = TABLEBASE_MAGIC) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat status;
+        if (fd < 0 || fstat(fd, &status) != 0) {
+            std::cerr << "Failed to open " << path << "." << std::endl;
+            if (fd >= 0) ::close(fd);
+            return;
+        }
+        _size = status.st_size;
+        _mapping = _size < sizeof(TablebaseHeader)
+            ? MAP_FAILED : mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);  // The mapping outlives the descriptor.
+        if (_mapping == MAP_FAILED) {
+            std::cerr << "Failed to map " << path << "." << std::endl;
+            return;
+        }
+
+        const TablebaseHeader* header = static_cast<const TablebaseHeader*>(_mapping);
+        if (!std::equal(std::begin(magic), std::end(magic), header->magic)
+                || header->version != TABLEBASE_VERSION) {
+            std::cerr << path << " is not a version " << TABLEBASE_VERSION << " "
+                      << std::string(magic, strnlen(magic, sizeof(magic))) << " file." << std::endl;
+        }
+        else if (header->tiles != TILES || header->count != RANK_COUNT
+                || _size != sizeof(TablebaseHeader) + RANK_COUNT * sizeof(uint16_t)) {
+            std::cerr << path << " was solved for " << header->tiles << " tiles, not " << TILES << "." << std::endl;
+        }
+        else {
+            // Agents jump all over the table, so every lookup is a TLB miss
+            // unless it's mapped with huge pages, which this asks the kernel
+            // to use (it's only a hint, and fine to ignore). Don't ask for
+            // MADV_RANDOM: it turns off the readahead that brings the file
+            // into the page cache as huge pages in the first place.
+            madvise(_mapping, _size, MADV_HUGEPAGE);
+            _values = reinterpret_cast<const uint16_t*>(header + 1);
+        }
+    }
+    ~Tablebase() {
+        if (_mapping != MAP_FAILED) munmap(_mapping, _size);
+    }
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    explicit operator bool() const { return _values != nullptr; }
+
+    // The probability that `self` goes on to win, with `self` to move.
+    [[ nodiscard ]] float operator[](Rank index) const { return _values[index] / TABLEBASE_SCALE; }
+    [[ nodiscard ]] float operator[](GameState state) const { return (*this)[rank(state)]; }
+    // The raw entry, e.g. the moves of a policy table.
+    [[ nodiscard ]] uint16_t entry(Rank index) const { return _values[index]; }
+
+    // Start fetching an entry, to be read shortly.
+    void prefetch(Rank index) const { __builtin_prefetch(_values + index); }
+
+private:
+    void* _mapping = MAP_FAILED;
+    size_t _size = 0;
+    const uint16_t* _values = nullptr;
+};
+
+
+// A concrete agent that plays perfectly by looking up every option.
+//
+// Many agents (even across processes) can share one tablebase.
+class TablebaseAgent : public Agent {
+public:
+    TablebaseAgent(std::shared_ptr<const Tablebase> tablebase)
+        : Agent("Tablebase"), _tablebase(std::move(tablebase)) { /* empty */ }
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
+        // Each lookup is likely a cache (and TLB) miss, so rank every option and
+        // start fetching them all before reading any, to wait on them together.
+        const GameState state = pack(self, other, true);
+        Rank ranks[TILES];
+        bool again[TILES];
+        unsigned count = 0;
+        for (unsigned long bits = options.to_ulong(); bits != 0; bits &= bits - 1, ++count) {
+            GameState next = state;
+            again[count] = apply(next, __builtin_ctzl(bits), steps);
+            ranks[count] = rank(again[count] ? next : swapped(next));
+            _tablebase->prefetch(ranks[count]);
+        }
+
+        Position move = INVALID;
+        float best = -1;
+        unsigned long bits = options.to_ulong();
+        for (unsigned i = 0; i < count; ++i, bits &= bits - 1) {
+            float value = (*_tablebase)[ranks[i]];
+            if (!again[i]) value = 1 - value;
+            if (value > best) {
+                best = value;
+                move = __builtin_ctzl(bits);
+            }
+        }
+        return move;
+    }
+private:
+    std::shared_ptr<const Tablebase> _tablebase;
+};
+
+
+// A concrete agent that plays a fixed policy from a policy table, e.g. a best
+// response to another agent (see `bestResponse`).
+//
+// The entry for a position holds the move to make for each roll, four bits
+// apiece with the move for a roll of one in the lowest bits.
+class PolicyAgent : public Agent {
+public:
+    PolicyAgent(std::shared_ptr<const Tablebase> policy)
+        : Agent("Policy"), _policy(std::move(policy)) { /* empty */ }
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
+        return (_policy->entry(rank(self, other)) >> (4 * (steps - 1))) & 0xF;
+    }
+private:
+    std::shared_ptr<const Tablebase> _policy;
+};
+
+
+/**********
+ * SOLVER *
+ **********/
+
+// The weight of each roll out of 16, i.e. 16 times the Bin(4, 0.5) pmf.
+constexpr std::array<unsigned, 5> ROLL_WEIGHTS = {1, 4, 6, 4, 1};
+
+
+// Time a callable, returning the elapsed wall-clock seconds.
+template <typename Function>
+double timeIt(Function&& function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return elapsed.count();
+}
+
+
+// Run `function(begin, end)` over [0, count) in chunks, spread over every core.
+//
+// Chunks are handed out in order from a shared counter, so a chunk's position
+// says nothing about which thread runs it.
+template <typename Function>
+void parallelChunks(uint64_t count, uint64_t chunk, Function&& function) {
+    std::atomic<uint64_t> next{0};
+    auto work = [&] {
+        for (uint64_t begin; (begin = next.fetch_add(chunk)) < count; ) {
+            function(begin, std::min(count, begin + chunk));
+        }
+    };
+    std::vector<std::thread> threads(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    for (std::thread& thread : threads) thread = std::thread(work);
+    work();
+    for (std::thread& thread : threads) thread.join();
+}
+
+
+// The value of a position, under some assignment of values to all positions,
+// split into the rolls that move and the rolls that pass.
+//
+// Every value is the probability that the player to move (i.e. `self`) goes on
+// to win, before they roll. The player to move picks the best option for each
+// roll, whether that keeps the turn (on a rosette) or hands it over. Rolling a
+// zero, or having no legal moves, passes the turn, which is worth
+// `1 - value(swapped(state))`. So the value of the position is::
+//
+//     moves + pass * (1 - value(swapped(state)))
+//
+// Splitting it up like this lets a solver handle a position and its swapped
+// twin together, since they depend on each other through passing.
+//
+// `value(state)` should look up the current value of any position.
+struct Backup {
+    float moves;  // The weighted value of the rolls that move.
+    float pass;  // The probability of passing the turn.
+};
+template <typename Lookup>
+[[ nodiscard ]] Backup backupMoves(GameState state, Lookup&& value) {
+    if ((state.bits & (HALF_OCCUPIED | HALF_REMAINING)) == 0) return {1, 0};
+    if (isOver(state)) return {0, 0};
+
+    unsigned pass = ROLL_WEIGHTS[0];
+    float moves = 0;
+    for (Steps steps = 1; steps <= 4; ++steps) {
+        Options options = getOptions(state, steps);
+        if (options.none()) pass += ROLL_WEIGHTS[steps];
+        float best = 0;
+        for (unsigned long bits = options.to_ulong(); bits != 0; bits &= bits - 1) {
+            GameState next = state;
+            bool again = apply(next, __builtin_ctzl(bits), steps);
+            best = std::max(best, again ? value(next) : 1 - value(swapped(next)));
+        }
+        moves += ROLL_WEIGHTS[steps] * best;
+    }
+    return {moves / 16, pass / 16.0f};
+}
+template <typename Lookup>
+[[ nodiscard ]] float backup(GameState state, Lookup&& value) {
+    Backup parts = backupMoves(state, value);
+    return parts.pass == 0 ? parts.moves : parts.moves + parts.pass * (1 - value(swapped(state)));
+}
+
+
+// The values of one layer of positions: those with a given number of tiles
+// borne off between both sides. They're indexed relative to the layer.
+struct Layer {
+    Rank begin = RANK_COUNT, end = RANK_COUNT;
+    std::unique_ptr<std::atomic<float>[]> values;
+
+    Layer() { /* empty */ }
+    explicit Layer(unsigned total)
+        : begin(RANKING.layers[total]), end(RANKING.layers[total + 1]),
+          values(new std::atomic<float>[end - begin]) { /* empty */ }
+
+    [[ nodiscard ]] float operator[](Rank index) const {
+        return values[index - begin].load(std::memory_order_relaxed);
+    }
+};
+
+
+// Compute the optimal value of every position in `layer` by value iteration.
+//
+// No move ever brings a tile back once it's borne off, so the number of tiles
+// borne off never goes down. Every move either stays in the layer or moves up
+// to `next`, which must already be solved.
+//
+// Within the layer there are cycles (captures send tiles back to the pile), so
+// we sweep it until no value moves by more than `tolerance`. Sweeps update in
+// place (Gauss-Seidel) and run back to front, since that's the direction in
+// which values propagate.
+//
+// The tightest cycle is two players passing back and forth, e.g. while each
+// waits on the exact roll to bear off. So a position and its swapped twin are
+// updated together, by solving the pair of equations from `backupMoves`
+// exactly; otherwise that cycle alone can take hundreds of sweeps.
+void solveLayer(unsigned total, Layer& layer, const Layer& next, float tolerance) {
+    parallelChunks(layer.end - layer.begin, 1 << 16, [&](Rank begin, Rank end) {
+        for (Rank index = begin; index < end; ++index) {
+            layer.values[index].store(0.5, std::memory_order_relaxed);
+        }
+    });
+    auto value = [&](GameState state) {
+        Rank index = rank(state);
+        return index < layer.end ? layer[index] : next[index];
+    };
+
+    const Rank size = layer.end - layer.begin;
+    for (size_t sweep = 1; ; ++sweep) {
+        std::mutex mutex;
+        float delta = 0;
+        double seconds = timeIt([&] {
+            parallelChunks(size, 1 << 14, [&](Rank begin, Rank end) {
+                float local = 0;
+                auto update = [&](Rank index, float updated) {
+                    std::atomic<float>& stored = layer.values[index - layer.begin];
+                    local = std::max(local, std::abs(updated - stored.load(std::memory_order_relaxed)));
+                    stored.store(updated, std::memory_order_relaxed);
+                };
+                for (Rank index = layer.end - begin; index-- > layer.end - end; ) {
+                    GameState state = unrank(index, true);
+                    Rank twin = rank(swapped(state));
+                    if (twin > index) continue;  // We got to the pair from the twin.
+
+                    // Solve x = a + c(1 - y) and y = b + d(1 - x) for both.
+                    Backup self = backupMoves(state, value);
+                    if (twin == index) {
+                        update(index, (self.moves + self.pass) / (1 + self.pass));
+                        continue;
+                    }
+                    Backup other = backupMoves(swapped(state), value);
+                    float x = (self.moves + self.pass * (1 - other.moves - other.pass))
+                            / (1 - self.pass * other.pass);
+                    update(index, x);
+                    update(twin, other.moves + other.pass * (1 - x));
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                delta = std::max(delta, local);
+            });
+        });
+        std::cout << "Layer " << total << ", sweep " << sweep << ": max delta " << delta
+                  << " (" << seconds << "s)" << std::endl;
+        if (delta <= tolerance) break;
+    }
+}
+
+
+/******************
+ * TRANSPOSITIONS *
+ ******************/
+
+// Random keys for Zobrist hashing.
+//
+// Keys are by player (first or second) rather than by `self`/`other`, so that
+// handing over the turn only toggles `firstToMove` rather than rekeying both
+// sides. The search depth is part of the key too, so that a table entry is
+// only ever reused at the depth it was searched to.
+//
+// That bounds how deep a search can go: nodes below the root are keyed by the
+// rolls left after them, i.e. up to `MAX_SEARCH_DEPTH - 1`.
+constexpr unsigned MAX_SEARCH_DEPTH = 64;
+struct _ZobristKeys {
+    uint64_t occupied[2][16];
+    uint64_t remaining[2][TILES + 1];
+    uint64_t firstToMove;
+    uint64_t depth[MAX_SEARCH_DEPTH];
+};
+constexpr _ZobristKeys _makeZobristKeys() {
+    _ZobristKeys keys{};
+    uint64_t seed = 0x5EED;
+    for (auto& player : keys.occupied) for (uint64_t& key : player) key = _splitmix64(seed);
+    for (auto& player : keys.remaining) for (uint64_t& key : player) key = _splitmix64(seed);
+    keys.firstToMove = _splitmix64(seed);
+    for (uint64_t& key : keys.depth) key = _splitmix64(seed);
+    // Bit 0 is redundant with `remaining`, and bit 15 is never set.
+    for (auto& player : keys.occupied) player[0] = player[15] = 0;
+    return keys;
+}
+constexpr _ZobristKeys ZOBRIST = _makeZobristKeys();
+
+// The Zobrist hash of one half of a game state, owned by the given player.
+[[ nodiscard ]] inline uint64_t zobrist(uint64_t half, bool first) {
+    const unsigned player = first ? 0 : 1;
+    uint64_t key = ZOBRIST.remaining[player][(half & HALF_REMAINING) >> REMAINING_SHIFT];
+    for (uint64_t bits = half & 0x7FFE; bits != 0; bits &= bits - 1) {
+        key ^= ZOBRIST.occupied[player][__builtin_ctzll(bits)];
+    }
+    return key;
+}
+// The Zobrist hash of a whole game state.
+[[ nodiscard ]] inline uint64_t zobrist(GameState state) {
+    bool first = firstToMove(state);
+    return zobrist(state.bits & 0xFFFFFFFF, first) ^ zobrist(state.bits >> 32, !first)
+         ^ (first ? ZOBRIST.firstToMove : 0);
+}
+
+
+// The Zobrist hash of a pair of sides, with `self` to move.
+[[ nodiscard ]] inline uint64_t zobrist(Side self, Side other, bool firstToMove) {
+    return zobrist(pack(self, other, firstToMove));
+}
+
+// The Zobrist key after handing over the turn.
+[[ nodiscard ]] constexpr uint64_t swappedKey(uint64_t key) { return key ^ ZOBRIST.firstToMove; }
+
+// The change in Zobrist key from a move, given the two sides beforehand. Only
+// the squares and piles that the move touches contribute.
+[[ nodiscard ]] inline uint64_t _zobristDelta(uint16_t selfRemaining, uint16_t otherRemaining,
+                                              bool captures, Position start, Steps steps, bool first) {
+    const unsigned self = first ? 0 : 1, other = 1 - self;
+    Position end = start + steps;
+    uint64_t delta = start == 0
+        ? ZOBRIST.remaining[self][selfRemaining] ^ ZOBRIST.remaining[self][selfRemaining - 1]
+        : ZOBRIST.occupied[self][start];
+    if (end < 15) delta ^= ZOBRIST.occupied[self][end];
+    if (captures) {
+        delta ^= ZOBRIST.occupied[other][end]
+               ^ ZOBRIST.remaining[other][otherRemaining] ^ ZOBRIST.remaining[other][otherRemaining + 1];
+    }
+    return delta;
+}
+
+// Apply a move like `apply(Side&, Side&, Position, Steps)`, and update `key`,
+// the Zobrist hash of the sides, to match. `first` says whether `self` is the
+// first player.
+//
+// Pre: The proposed move is valid.
+[[ nodiscard ]] inline Undo apply(Side& self, Side& other, Position start, Steps steps,
+                                  bool first, uint64_t& key) {
+    uint16_t selfRemaining = self.remaining, otherRemaining = other.remaining;
+    Undo move = apply(self, other, start, steps);
+    key ^= _zobristDelta(selfRemaining, otherRemaining, move.captured, start, steps, first);
+    return move;
+}
+
+// Take back a move like `undo(Side&, Side&, const Undo&)`, restoring `key` too.
+inline void undo(Side& self, Side& other, const Undo& move, bool first, uint64_t& key) {
+    undo(self, other, move);
+    key ^= _zobristDelta(self.remaining, other.remaining, move.captured, move.start,
+                         move.end - move.start, first);
+}
+
+// The packed equivalent. There's no `undo`, since copying a `GameState` is
+// cheaper than undoing a move.
+template <typename StepsT>
+[[ nodiscard ]] inline bool _apply(GameState& state, Position start, StepsT steps, uint64_t& key) {
+    Position end = start + steps;
+    bool captures = 5 <= end && end <= 12 && (state.bits >> (32 + end) & 1);
+    key ^= _zobristDelta(state.bits >> REMAINING_SHIFT & 0xF, state.bits >> (REMAINING_SHIFT + 32) & 0xF,
+                         captures, start, steps, firstToMove(state));
+    return _apply(state, start, steps);
+}
+[[ nodiscard ]] inline bool apply(GameState& state, Position start, Steps steps, uint64_t& key) {
+    return _apply(state, start, steps, key);
+}
+template <Steps S>
+[[ nodiscard ]] inline bool apply(GameState& state, Position start, uint64_t& key) {
+    return _apply(state, start, StepsConstant<S>{}, key);
+}
+
+// Verify that hashed moves keep the key in step with the sides, and that
+// `undo` takes them back exactly, over many random games.
+bool _verifyZobrist() {
+    std::mt19937 gen(7);
+    for (size_t game = 0; game < 1000; ++game) {
+        Side left = START, right = START;
+        bool current = true;
+        uint64_t key = zobrist(left, right, true);
+        while (left != COMPLETE && right != COMPLETE) {
+            Side& self = current ? left : right;
+            Side& other = current ? right : left;
+            Steps steps = 1 + gen() % 4;
+            bool again = false;
+            Options options = getOptions(self, other, steps);
+            for (Position start = 0; start < 15; ++start) {
+                if (!options.test(start)) continue;
+                // Try every move and take it back, then make a random one for real.
+                const Side self0 = self, other0 = other;
+                const uint64_t key0 = key;
+                Undo move = apply(self, other, start, steps, current, key);
+                if (key != zobrist(self, other, current)) return false;
+                undo(self, other, move, current, key);
+                if (self != self0 || other != other0 || key != key0) return false;
+            }
+            if (options.any()) {
+                std::vector<Position> moves;
+                for (Position start = 0; start < 15; ++start) if (options.test(start)) moves.push_back(start);
+                again = apply(self, other, moves[gen() % moves.size()], steps, current, key).again;
+            }
+            if (!again) {
+                current = !current;
+                key = swappedKey(key);
+            }
+            if (key != zobrist(current ? left : right, current ? right : left, current)) return false;
+        }
+    }
+    return true;
+}
+
+
+// A fixed-size hash table of search results, shared freely between threads.
+//
+// Every bucket is one cache line holding four entries. An entry is two words,
+// `key ^ data` and `data`, written without locks. If two threads race on an
+// entry, or a probe reads one half-written, the key won't check out and the
+// probe simply misses (Hyatt and Mann's lockless hashing).
+//
+// When a bucket is full, the entry to evict depends on the replacement policy:
+// - `Always`: whichever slot the key picks, as in a direct-mapped table.
+// - `Deepest`: the shallowest entry, since it was the cheapest to compute.
+// - `Aged`: the shallowest, counting entries from older searches as shallower
+//   (by 4 plies per search); see `newSearch()`.
+class TranspositionTable {
+public:
+    enum class Replacement { Always, Deepest, Aged };
+    enum class Bound : uint8_t { Exact, Lower, Upper };
+    struct Entry {
+        float value;
+        Bound bound;
+        uint8_t depth;
+    };
+
+    TranspositionTable(size_t megabytes, Replacement replacement = Replacement::Aged)
+        : _replacement(replacement) {
+        size_t buckets = 1;
+        while (2 * buckets * sizeof(Bucket) <= megabytes << 20) buckets *= 2;
+        _buckets.reset(new Bucket[buckets]);
+        _mask = buckets - 1;
+        clear();
+    }
+
+    // Forget every entry. This isn't safe to call during a search.
+    void clear() {
+        for (size_t b = 0; b <= _mask; ++b) {
+            for (std::atomic<uint64_t>& word : _buckets[b].words) word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Start a new search, making the entries from older ones easier to evict.
+    void newSearch() { _generation.fetch_add(1, std::memory_order_relaxed); }
+
+    [[ nodiscard ]] bool probe(uint64_t key, Entry& entry) const {
+        const Bucket& bucket = _buckets[key & _mask];
+        for (size_t slot = 0; slot < 4; ++slot) {
+            uint64_t data = bucket.words[2 * slot + 1].load(std::memory_order_relaxed);
+            if ((bucket.words[2 * slot].load(std::memory_order_relaxed) ^ data) == key) {
+                entry = _unpack(data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t key, const Entry& entry) {
+        Bucket& bucket = _buckets[key & _mask];
+        uint8_t generation = _generation.load(std::memory_order_relaxed);
+        size_t victim = key >> 62;
+        if (_replacement != Replacement::Always) {
+            int worst = INT_MAX;
+            for (size_t slot = 0; slot < 4; ++slot) {
+                uint64_t data = bucket.words[2 * slot + 1].load(std::memory_order_relaxed);
+                if ((bucket.words[2 * slot].load(std::memory_order_relaxed) ^ data) == key) {
+                    victim = slot;
+                    break;
+                }
+                int score = _unpack(data).depth;
+                if (_replacement == Replacement::Aged) {
+                    score -= 4 * uint8_t(generation - (data >> 48));
+                }
+                if (score < worst) {
+                    worst = score;
+                    victim = slot;
+                }
+            }
+        }
+        uint64_t data = _pack(entry, generation);
+        bucket.words[2 * victim].store(key ^ data, std::memory_order_relaxed);
+        bucket.words[2 * victim + 1].store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) Bucket {
+        std::atomic<uint64_t> words[8];
+    };
+
+    // Bits 0..31 hold the value, 32..33 the bound, 40..47 the depth and
+    // 48..55 the generation.
+    [[ nodiscard ]] static uint64_t _pack(const Entry& entry, uint8_t generation) {
+        uint32_t value;
+        std::memcpy(&value, &entry.value, sizeof(value));
+        return value | uint64_t(entry.bound) << 32 | uint64_t(entry.depth) << 40 | uint64_t(generation) << 48;
+    }
+    [[ nodiscard ]] static Entry _unpack(uint64_t data) {
+        Entry entry;
+        uint32_t value = data;
+        std::memcpy(&entry.value, &value, sizeof(value));
+        entry.bound = Bound(data >> 32 & 3);
+        entry.depth = data >> 40;
+        return entry;
+    }
+
+    std::unique_ptr<Bucket[]> _buckets;
+    size_t _mask = 0;
+    Replacement _replacement;
+    std::atomic<uint8_t> _generation{0};
+};
+
+
+// Verify that the table never returns an entry other than one stored under the
+// same key, even while several threads store into the same buckets at once.
+bool _verifyTranspositionTable() {
+    TranspositionTable table(1, TranspositionTable::Replacement::Always);
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t) {
+        threads.emplace_back([&table, &ok, t] {
+            uint64_t seed = t;
+            for (size_t i = 0; i < (1 << 20); ++i) {
+                // Only a few distinct keys, so that threads collide constantly.
+                uint64_t key = _splitmix64(seed) & 0xFFFF00000000FFFF;
+                TranspositionTable::Entry entry;
+                if (table.probe(key, entry)) {
+                    if (entry.value != float(key & 0xFFFF) || entry.depth != (key >> 48 & 0x3F)) ok = false;
+                }
+                else table.store(key, {float(key & 0xFFFF), TranspositionTable::Bound::Exact, uint8_t(key >> 48 & 0x3F)});
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    return ok;
+}
+
+
+/**********
+ * SEARCH *
+ **********/
+
+// A crude estimate of the probability that `self` wins: who's further along.
+//
+// Each tile counts for its position on the path, so a borne-off tile is worth
+// 15 and a tile in the pile is worth nothing.
+[[ nodiscard ]] inline float evaluate(GameState state) {
+    auto progress = [](uint64_t half) {
+        int total = 15 * finished((half & HALF_REMAINING) >> REMAINING_SHIFT, half & HALF_OCCUPIED);
+        for (uint64_t bits = half & 0x7FFE; bits != 0; bits &= bits - 1) total += __builtin_ctzll(bits);
+        return total;
+    };
+    int lead = progress(state.bits) - progress(state.bits >> 32);
+    return 0.5f + lead / (2.0f * 15 * TILES);
+}
+
+
+// Counters for a search, to see how much of the tree it actually visits.
+struct SearchStats {
+    uint64_t chanceNodes = 0;
+    uint64_t maxNodes = 0;
+    uint64_t leaves = 0;
+    uint64_t star1Cutoffs = 0;  // Chance nodes cut off while searching.
+    uint64_t star2Cutoffs = 0;  // Chance nodes cut off by probing alone.
+    uint64_t tableProbes = 0;
+    uint64_t tableHits = 0;  // Probes that found an entry...
+    uint64_t tableCutoffs = 0;  // ...and those that could use it.
+    double seconds = 0;
+
+    [[ nodiscard ]] uint64_t nodes() const { return chanceNodes + maxNodes + leaves; }
+};
+std::ostream& operator<<(std::ostream& out, const SearchStats& stats) {
+    out << stats.nodes() << " nodes, " << stats.nodes() / stats.seconds / 1e6 << " M nodes/s";
+    // A search one roll deep never reaches a chance node.
+    if (stats.chanceNodes != 0) {
+        out << ", " << 100.0 * stats.star1Cutoffs / stats.chanceNodes << "% Star1 and "
+            << 100.0 * stats.star2Cutoffs / stats.chanceNodes << "% Star2 cutoffs";
+    }
+    if (stats.tableProbes != 0) {
+        out << ", " << 100.0 * stats.tableHits / stats.tableProbes << "% table hits ("
+            << 100.0 * stats.tableCutoffs / stats.tableProbes << "% used)";
+    }
+    return out;
+}
+
+
+// A concrete agent that searches a fixed number of rolls ahead.
+//
+// This is expectiminimax where every value is the probability that the player
+// to move wins, so handing over the turn maps a value `v` to `1 - v` and a
+// window (alpha, beta) to (1 - beta, 1 - alpha). Landing on a rosette keeps
+// the turn, so the same player can be on both sides of a chance node.
+//
+// Chance nodes are pruned with Ballard's Star1 and Star2. Star1 bounds each
+// outcome's window using the bounds [0, 1] on the outcomes not yet searched.
+// Star2 first probes every outcome with a single move, which gives a cheap
+// lower bound on each; that alone often proves a cutoff, and otherwise tightens
+// the Star1 windows. With `pruning` off, this is plain expectimax.
+//
+// Given a transposition table, chance nodes (but the shallowest) are looked up
+// before they're searched and stored afterwards. Agents (even on other
+// threads) may share one.
+//
+// The depth counts the roll being played, so a depth of 1 just evaluates the
+// position after each move; a depth of 0 is taken to mean the same. Depths
+// past `MAX_SEARCH_DEPTH` (far more than could ever finish) are cut down to it.
+class ExpectiminimaxAgent : public Agent {
+public:
+    ExpectiminimaxAgent(unsigned depth, bool pruning = true,
+                        std::shared_ptr<TranspositionTable> table = nullptr)
+        : Agent("Expectiminimax"), _depth(std::clamp(depth, 1u, MAX_SEARCH_DEPTH)), _pruning(pruning),
+          _table(std::move(table)) { /* empty */ }
+    virtual Position getMove(Side self, Side other, Steps steps, Options options) {
+        auto begin = std::chrono::steady_clock::now();
+        if (_table) _table->newSearch();
+        Position move = INVALID;
+        _value = -1;
+        const GameState state = pack(self, other, true);
+        const uint64_t key = zobrist(state);
+        withSteps(steps, [&](auto s) {
+            for (Position start : _order<s>(state, options)) {
+                if (start == INVALID) break;
+                float value = _move<s>(state, key, start, _depth, _pruning ? std::max(_value, 0.0f) : 0, 1);
+                if (value > _value) {
+                    _value = value;
+                    move = start;
+                }
+            }
+        });
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        stats.seconds += elapsed.count();
+        return move;
+    }
+
+    // The value of the move chosen by the latest call to `getMove`.
+    [[ nodiscard ]] float value() const { return _value; }
+
+    SearchStats stats;
+
+private:
+    // The moves in `options`, likeliest best first: rosettes, then captures,
+    // then the tiles furthest along. The list is padded out with `INVALID`.
+    template <Steps S>
+    [[ nodiscard ]] static std::array<Position, 8> _order(GameState state, Options options) {
+        std::array<Position, 8> moves;
+        moves.fill(INVALID);
+        std::array<int, 8> scores{};
+        size_t count = 0;
+        for (unsigned long bits = options.to_ulong(); bits != 0; bits &= bits - 1) {
+            Position start = __builtin_ctzl(bits);
+            Position end = start + S;
+            int score = start;
+            if (end == 4 || end == 8 || end == 14) score += 32;
+            else if (5 <= end && end <= 12 && (state.bits >> (32 + end) & 1)) score += 16;
+            // Insertion sort: there are at most seven moves.
+            size_t i = count++;
+            for (; i > 0 && scores[i - 1] < score; --i) {
+                moves[i] = moves[i - 1];
+                scores[i] = scores[i - 1];
+            }
+            moves[i] = start;
+            scores[i] = score;
+        }
+        return moves;
+    }
+
+    // The value of making a move, for the player making it.
+    //
+    // Every node carries the Zobrist key of its state, kept up to date move by
+    // move, for the transposition table.
+    template <Steps S>
+    [[ nodiscard ]] float _move(GameState state, uint64_t key, Position start,
+                                unsigned depth, float alpha, float beta) {
+        bool again = apply<S>(state, start, key);
+        return again ? _chance(state, key, depth - 1, alpha, beta)
+                     : 1 - _chance(swapped(state), swappedKey(key), depth - 1, 1 - beta, 1 - alpha);
+    }
+
+    // The value of passing the turn, for the player passing it.
+    [[ nodiscard ]] float _pass(GameState state, uint64_t key, unsigned depth, float alpha, float beta) {
+        return 1 - _chance(swapped(state), swappedKey(key), depth - 1, 1 - beta, 1 - alpha);
+    }
+
+    // The value of a roll, i.e. of the best move, for the player who rolled.
+    //
+    // If `probe` is set, only the first move is tried, which gives a lower bound.
+    // That bound is always exact (probes never fail low), so the full search
+    // can pass it back in as `first` rather than search the first move again.
+    [[ nodiscard ]] float _roll(GameState state, uint64_t key, Steps steps, unsigned depth,
+                                float alpha, float beta, bool probe = false, float first = -1) {
+        if (steps == 0) {
+            stats.maxNodes++;
+            return first >= 0 ? first : _pass(state, key, depth, alpha, beta);
+        }
+        return withSteps(steps, [&](auto s) { return _roll<s>(state, key, depth, alpha, beta, probe, first); });
+    }
+
+    // The same, for a roll of `S` other than 0.
+    template <Steps S>
+    [[ nodiscard ]] float _roll(GameState state, uint64_t key, unsigned depth,
+                                float alpha, float beta, bool probe, float first) {
+        stats.maxNodes++;
+        Options options = getOptions<S>(state);
+        if (options.none()) return first >= 0 ? first : _pass(state, key, depth, alpha, beta);
+
+        float best = 0;
+        for (Position start : _order<S>(state, options)) {
+            if (start == INVALID) break;
+            float value = first >= 0 ? first : _move<S>(state, key, start, depth, std::max(alpha, best), beta);
+            first = -1;
+            best = std::max(best, value);
+            if (probe || (_pruning && best >= beta)) break;
+        }
+        return best;
+    }
+
+    // The value of a position before the roll, for the player about to roll.
+    [[ nodiscard ]] float _chance(GameState state, uint64_t key, unsigned depth, float alpha, float beta) {
+        if ((state.bits & (HALF_OCCUPIED | HALF_REMAINING)) == 0) return 1;
+        if (isOver(state)) return 0;
+        if (depth == 0) {
+            stats.leaves++;
+            return evaluate(state);
+        }
+        if (!_table || depth < _TABLE_DEPTH) return _search(state, key, depth, alpha, beta);
+
+        using Bound = TranspositionTable::Bound;
+        const uint64_t entryKey = key ^ ZOBRIST.depth[depth];
+        TranspositionTable::Entry entry;
+        stats.tableProbes++;
+        if (_table->probe(entryKey, entry)) {
+            stats.tableHits++;
+            if (entry.bound == Bound::Exact || (entry.bound == Bound::Lower && entry.value >= beta)
+                    || (entry.bound == Bound::Upper && entry.value <= alpha)) {
+                stats.tableCutoffs++;
+                return entry.value;
+            }
+        }
+        float value = _search(state, key, depth, alpha, beta);
+        entry.value = value;
+        entry.bound = value >= beta ? Bound::Lower : value <= alpha ? Bound::Upper : Bound::Exact;
+        entry.depth = depth;
+        _table->store(entryKey, entry);
+        return value;
+    }
+
+    // Search a chance node that isn't a leaf, with Star1/Star2 if enabled.
+    [[ nodiscard ]] float _search(GameState state, uint64_t key, unsigned depth, float alpha, float beta) {
+        stats.chanceNodes++;
+
+        // The rolls, likeliest first, and their probabilities.
+        static constexpr std::array<Steps, 5> ROLLS = {2, 1, 3, 0, 4};
+        std::array<float, 5> probability;
+        for (size_t i = 0; i < ROLLS.size(); ++i) probability[i] = ROLL_WEIGHTS[ROLLS[i]] / 16.0f;
+
+        if (!_pruning) {
+            float total = 0;
+            for (size_t i = 0; i < ROLLS.size(); ++i) {
+                total += probability[i] * _roll(state, key, ROLLS[i], depth, 0, 1);
+            }
+            return total;
+        }
+
+        // Star2: probe every roll with one move for a lower bound on its value.
+        std::array<float, 5> lower{};
+        float lowerSum = 0;  // The lower bounds so far, times their probabilities.
+        for (size_t i = 0; i < ROLLS.size(); ++i) {
+            // Past 1, even a perfect result here can't cut off.
+            float childBeta = std::min(1.0f, (beta - lowerSum) / probability[i]);
+            float value = _roll(state, key, ROLLS[i], depth, 0, childBeta, true);
+            if (value >= childBeta && childBeta < 1) {
+                stats.star2Cutoffs++;
+                return lowerSum + probability[i] * value;
+            }
+            lower[i] = value;
+            lowerSum += probability[i] * value;
+        }
+        if (lowerSum >= beta) {
+            stats.star2Cutoffs++;
+            return lowerSum;
+        }
+
+        // Star1: search every roll in full, with a window derived from the
+        // bounds on the rolls still to come.
+        float known = 0;  // The exact values so far, times their probabilities.
+        float upper = 1;  // The probability of the rolls not yet searched.
+        for (size_t i = 0; i < ROLLS.size(); ++i) {
+            upper -= probability[i];
+            lowerSum -= probability[i] * lower[i];
+            float childAlpha = (alpha - known - upper) / probability[i];
+            float childBeta = (beta - known - lowerSum) / probability[i];
+            if (childAlpha >= 1 || childBeta <= 0) {
+                // No result here could bring the total back inside the window.
+                stats.star1Cutoffs++;
+                return childAlpha >= 1 ? known + probability[i] + upper : known + lowerSum;
+            }
+            float value = _roll(state, key, ROLLS[i], depth, std::max(0.0f, childAlpha),
+                                std::min(1.0f, childBeta), false, lower[i]);
+            if (value >= childBeta) {
+                stats.star1Cutoffs++;
+                return known + probability[i] * value + lowerSum;
+            }
+            if (value <= childAlpha) {
+                stats.star1Cutoffs++;
+                return known + probability[i] * value + upper;
+            }
+            known += probability[i] * value;
+        }
+        return known;
+    }
+
+    unsigned _depth;
+    bool _pruning;
+    std::shared_ptr<TranspositionTable> _table;
+
+    // The least depth at which chance nodes go through the table. Nodes one
+    // roll from the leaves are too cheap to search for a probe and a store to
+    // pay off, and take most of the table's room (see `ur search`).
+    static constexpr unsigned _TABLE_DEPTH = 2;
+    float _value = -1;
+};
+
+
+/***************
+ * TOURNAMENTS *
+ ***************/
+
+// Makes a fresh agent, so that every thread in a tournament can have its own.
+using AgentFactory = std::function<std::unique_ptr<Agent>()>;
+
+
+// The outcome of a tournament between two agents.
+struct TournamentResult {
+    uint64_t games = 0;
+    uint64_t firstWins = 0;
+    double seconds = 0;
+
+    [[ nodiscard ]] double gamesPerSecond() const { return games / seconds; }
+};
+
+
+// A range of games [begin, end) still to be played, owned by one worker but
+// open to theft by the others. Aligned so that workers don't share cache lines.
+struct alignas(64) _GameRange {
+    std::mutex mutex;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+// Take up to `chunk` games from the front of our own range. Returns an empty
+// range once it's run dry.
+inline std::pair<uint64_t, uint64_t> _takeGames(_GameRange& range, uint64_t chunk) {
+    std::lock_guard<std::mutex> lock(range.mutex);
+    uint64_t begin = range.begin;
+    range.begin = std::min(range.end, begin + chunk);
+    return {begin, range.begin};
+}
+
+// Steal the back half of another worker's range (or its last game) into ours.
+// Returns whether there was anything to steal.
+inline bool _stealGames(_GameRange& victim, _GameRange& range) {
+    uint64_t begin, end;
+    {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin == victim.end) return false;
+        begin = victim.end - std::max<uint64_t>(1, (victim.end - victim.begin) / 2);
+        end = victim.end;
+        victim.end = begin;
+    }
+    std::lock_guard<std::mutex> lock(range.mutex);
+    range.begin = begin;
+    range.end = end;
+    return true;
+}
+
+
+// Run `count` items of work (e.g. games) on `threads` threads, a chunk at a
+// time. Each thread calls `makeWork(w)` once, with its index `w`, to set up
+// (e.g. make its own agents), and then calls the result with each `[begin,
+// end)` range of items it takes on.
+//
+// The items are dealt out evenly up front, and a thread that runs out steals
+// half of whatever another has left, so the only contention is over the
+// ranges, a chunk at a time. If given, setting `stop` stops every thread
+// before its next chunk.
+template <typename MakeWork>
+void workStealing(uint64_t count, unsigned threads, uint64_t chunk, MakeWork&& makeWork,
+                  const std::atomic<bool>* stop = nullptr) {
+    std::vector<_GameRange> ranges(threads);
+    for (unsigned w = 0; w < threads; ++w) {
+        ranges[w].begin = count * w / threads;
+        ranges[w].end = count * (w + 1) / threads;
+    }
+    auto run = [&](unsigned w) {
+        auto work = makeWork(w);
+        while (!stop || !stop->load(std::memory_order_relaxed)) {
+            auto [begin, end] = _takeGames(ranges[w], chunk);
+            if (begin == end) {
+                // Look for a victim, starting with our neighbour. If everyone
+                // has run dry, we're done, since no more work ever appears.
+                bool stolen = false;
+                for (unsigned v = 1; v < threads && !stolen; ++v) {
+                    stolen = _stealGames(ranges[(w + v) % threads], ranges[w]);
+                }
+                if (!stolen) break;
+                continue;
+            }
+            work(begin, end);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned w = 1; w < threads; ++w) workers.emplace_back(run, w);
+    run(0);
+    for (std::thread& worker : workers) worker.join();
+}
+
+
+// Play `games` games between two agents on `threads` threads, the agent from
+// `first` always moving first. Game i rolls `Roller(seed, i)` (e.g. `Dice` or
+// `PhiloxDice`), so a tournament plays out the same whatever the number of
+// threads, and any one game of it can be replayed alone.
+//
+// Each worker makes its own agents and counts its own wins, merged at the end.
+// The factories may be `AgentFactory`s, or return concrete agents (e.g.
+// `[] { return FarthestAgent(); }`) so that the games don't go through the
+// vtable at all. Given a log, each worker logs every game to its own writer.
+template <typename Roller = Dice, typename MakeFirst, typename MakeSecond>
+TournamentResult runTournament(const MakeFirst& first, const MakeSecond& second, uint64_t games,
+                               uint64_t seed,
+                               unsigned threads = std::max(1u, std::thread::hardware_concurrency()),
+                               GameLog* log = nullptr) {
+    struct alignas(64) Tally { uint64_t games = 0, firstWins = 0; };
+    std::vector<Tally> tallies(threads);
+
+    TournamentResult result;
+    result.seconds = timeIt([&] {
+        workStealing(games, threads, 64, [&](unsigned w) {
+            return [&, w, one = first(), two = second(), writer = log ? log->writer() : nullptr](
+                    uint64_t begin, uint64_t end) mutable {
+                for (uint64_t i = begin; i < end; ++i) {
+                    tallies[w].firstWins += writer ? playOneGame(one, two, Roller(seed, i), writer->game(i))
+                                                   : playOneGame(one, two, Roller(seed, i));
+                }
+                tallies[w].games += end - begin;
+            };
+        });
+    });
+    for (const Tally& tally : tallies) {
+        result.games += tally.games;
+        result.firstWins += tally.firstWins;
+    }
+    return result;
+}
+
+
+// Check that a binary log of a tournament on several threads, with rings small
+// enough to fill and interleave constantly, reads back into every game, each
+// one whole and just as it plays out when replayed alone.
+bool _verifyGameLog() {
+    const uint64_t games = 2000, seed = 1;
+    std::stringstream out;
+    GameLog log(out, LogFormat::Binary, 1 << 10);
+    TournamentResult result = runTournament(
+        [] { return FarthestAgent(); }, [] { return ClosestAgent(); }, games, seed, 4, &log);
+    log.close();
+
+    struct Game {
+        bool started = false, ended = false, firstWon = false;
+        uint64_t rolls = 0, length = 0;
+    };
+    std::vector<Game> read(games);
+    bool ok = true;
+    uint64_t events = 0;
+    ok &= readGameLog(out, [&](uint64_t game, LogEvent event) {
+        events++;
+        if (game >= games) {
+            ok = false;
+            return;
+        }
+        Game& g = read[game];
+        ok &= event.kind() == LogEvent::GameStarted ? !g.started : g.started && !g.ended;
+        if (event.kind() == LogEvent::GameStarted) g.started = true;
+        if (event.kind() == LogEvent::Roll) g.rolls++;
+        if (event.kind() == LogEvent::GameEnded) {
+            g.ended = true;
+            g.firstWon = event.first();
+            g.length = event.value();
+        }
+    });
+
+    uint64_t firstWins = 0;
+    FarthestAgent one;
+    ClosestAgent two;
+    for (uint64_t i = 0; i < games && ok; ++i) {
+        ok &= read[i].ended && read[i].rolls == read[i].length
+           && read[i].firstWon == playOneGame(one, two, Dice(seed, i));
+        firstWins += read[i].firstWon;
+    }
+    return ok && events == log.events() && firstWins == result.firstWins;
+}
+
+
+// The outcome of a match between agents A and B, played in pairs of games with
+// the seats swapped (see `runMatch`).
+struct MatchResult {
+    uint64_t pairs = 0;
+    std::array<uint64_t, 3> sweeps{};  // How many pairs A won none, one, or both of.
+    uint64_t firstWins = 0;  // How many games the first player won, whoever it was.
+    double seconds = 0;
+
+    // Count a pair, given whether the first player won each game.
+    void add(bool aFirstWon, bool bFirstWon) {
+        pairs++;
+        sweeps[aFirstWon + !bFirstWon]++;
+        firstWins += aFirstWon + bFirstWon;
+    }
+    MatchResult& operator+=(const MatchResult& other) {
+        pairs += other.pairs;
+        for (size_t k = 0; k < 3; ++k) sweeps[k] += other.sweeps[k];
+        firstWins += other.firstWins;
+        return *this;
+    }
+
+    [[ nodiscard ]] uint64_t games() const { return 2 * pairs; }
+    [[ nodiscard ]] double winRate() const { return (sweeps[1] + 2.0 * sweeps[2]) / games(); }
+    [[ nodiscard ]] double firstWinRate() const { return double(firstWins) / games(); }
+
+    // A's win rate less B's, which is the mean over pairs of A's wins less one.
+    [[ nodiscard ]] double difference() const { return double(sweeps[2]) / pairs - double(sweeps[0]) / pairs; }
+    // The variance of A's wins less one, per pair.
+    [[ nodiscard ]] double variance() const {
+        double mean = difference();
+        return double(sweeps[2] + sweeps[0]) / pairs - mean * mean;
+    }
+    // Half the width of a 95% confidence interval on `difference()`.
+    [[ nodiscard ]] double halfWidth() const { return 1.96 * std::sqrt(variance() / pairs); }
+};
+
+
+// Play pair `i` of a match between agents `one` (A) and `two` (B) into
+// `result`, the second game rolling the streams of pair `swapped` (see
+// `runMatch`).
+template <typename Roller>
+void _playPair(const std::unique_ptr<Agent>& one, const std::unique_ptr<Agent>& two,
+               uint64_t seed, uint64_t i, uint64_t swapped, MatchResult& result) {
+    bool aFirstWon = playOneGame(one, two, Roller(seed, 2 * i), Roller(seed, 2 * i + 1));
+    bool bFirstWon = playOneGame(two, one, Roller(seed, 2 * swapped), Roller(seed, 2 * swapped + 1));
+    result.add(aFirstWon, bFirstWon);
+}
+
+
+// Play `pairs` pairs of games between agents A and B on `threads` threads, and
+// compare them.
+//
+// Each pair is one game with A first and one with B first, so any advantage to
+// either seat cancels out. If `paired`, both games also roll the same dice
+// (common random numbers): each seat has its own stream, `Roller(seed, 2i)`
+// and `Roller(seed, 2i + 1)` for pair i, which the game with the seats swapped
+// then rolls again. Luck with the dice then mostly cancels out within a pair
+// too, leaving the difference between the agents. Otherwise, the second game of
+// each pair rolls fresh dice, as two unrelated games would. Either way, every
+// agent compared under the same seed sees the same dice.
+template <typename Roller = Dice>
+MatchResult runMatch(const AgentFactory& a, const AgentFactory& b, uint64_t pairs, uint64_t seed,
+                     bool paired = true, unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+    struct alignas(64) Tally { MatchResult result; };
+    std::vector<Tally> tallies(threads);
+
+    MatchResult result;
+    result.seconds = timeIt([&] {
+        workStealing(pairs, threads, 32, [&](unsigned w) {
+            return [&, w, one = a(), two = b()](uint64_t begin, uint64_t end) {
+                for (uint64_t i = begin; i < end; ++i) {
+                    _playPair<Roller>(one, two, seed, i, paired ? i : pairs + i, tallies[w].result);
+                }
+            };
+        });
+    });
+    for (const Tally& tally : tallies) result += tally.result;
+    return result;
+}
+
+
+// A test of whether agent A is stronger than agent B by at least `margin` in
+// win rate, from pairs of games as they come in.
+//
+// By default, it's Wald's sequential probability ratio test of no difference
+// (H0) against a difference of `margin` (H1), with the likelihood of each
+// pair's result approximated as normal (as for GSPRT in engine testing). It
+// stops once the log-likelihood ratio leaves [log(beta / (1 - alpha)),
+// log((1 - beta) / alpha)], so accepting H1 when H0 holds has probability at
+// most `alpha`, and vice versa for `beta`.
+//
+// Alternatively, the Bayesian rule puts a flat prior on the difference, so its
+// posterior is about normal around the observed difference, and stops once
+// the difference is above half of `margin` with probability at least 1 - alpha
+// (A is stronger), or below it with probability at least 1 - beta (it isn't).
+struct SequentialTest {
+    enum class Rule { Sprt, Bayes };
+    enum class Verdict { Undecided, Stronger, NotStronger };
+
+    double margin = 0.05;
+    double alpha = 0.05;
+    double beta = 0.05;
+    Rule rule = Rule::Sprt;
+    uint64_t minimumPairs = 64;  // Don't trust the variance before this.
+
+    [[ nodiscard ]] Verdict decide(const MatchResult& result) const {
+        if (result.pairs < minimumPairs) return Verdict::Undecided;
+        // With paired dice, identical agents always split a pair, for no
+        // variance at all. So assume at least one pair's worth.
+        const double mean = result.difference(), variance = std::max(result.variance(), 1.0 / result.pairs);
+        if (rule == Rule::Sprt) {
+            double llr = result.pairs * margin * (2 * mean - margin) / (2 * variance);
+            if (llr >= std::log((1 - beta) / alpha)) return Verdict::Stronger;
+            if (llr <= std::log(beta / (1 - alpha))) return Verdict::NotStronger;
+        } else {
+            double z = (mean - margin / 2) / std::sqrt(variance / result.pairs);
+            double above = 0.5 * std::erfc(-z / std::sqrt(2));  // P(difference > margin / 2)
+            if (above >= 1 - alpha) return Verdict::Stronger;
+            if (1 - above >= 1 - beta) return Verdict::NotStronger;
+        }
+        return Verdict::Undecided;
+    }
+};
+
+
+// Play pairs of games between agents A and B as in `runMatch` (always with
+// paired dice), testing the results with `test` as they come in from the
+// workers, and stop as soon as it reaches a verdict or after `maxPairs`.
+//
+// Workers report a small chunk of pairs at a time, so the test sees the
+// results within a few games of their being played.
+template <typename Roller = Dice>
+std::pair<MatchResult, SequentialTest::Verdict> runSequentialMatch(
+        const AgentFactory& a, const AgentFactory& b, uint64_t maxPairs, uint64_t seed,
+        const SequentialTest& test, unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+    using Verdict = SequentialTest::Verdict;
+    std::mutex mutex;
+    MatchResult result;
+    Verdict verdict = Verdict::Undecided;
+    std::atomic<bool> stop{false};
+
+    result.seconds = timeIt([&] {
+        workStealing(maxPairs, threads, 8, [&](unsigned) {
+            return [&, one = a(), two = b()](uint64_t begin, uint64_t end) {
+                MatchResult chunk;
+                for (uint64_t i = begin; i < end; ++i) _playPair<Roller>(one, two, seed, i, i, chunk);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (verdict != Verdict::Undecided) return;  // Too late.
+                result += chunk;
+                verdict = test.decide(result);
+                if (verdict != Verdict::Undecided) stop = true;
+            };
+        }, &stop);
+    });
+    return {result, verdict};
+}
+
+
+// Make agents by name: "farthest", "closest", "search" followed by a depth of
+// at least one roll (e.g. "search2"), or the path to a tablebase or policy table (ending
+// in ".tablebase" or ".policy"), which is loaded once and shared. Returns an
+// empty factory for any other name, or if the file won't load.
+AgentFactory agentNamed(const std::string& name) {
+    auto endsWith = [&](const std::string& suffix) {
+        return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (endsWith(".tablebase") || endsWith(".policy")) {
+        bool policy = endsWith(".policy");
+        auto table = std::make_shared<const Tablebase>(name, policy ? POLICY_MAGIC : TABLEBASE_MAGIC);
+        if (!*table) return nullptr;
+        if (policy) return [table] { return std::make_unique<PolicyAgent>(table); };
+        return [table] { return std::make_unique<TablebaseAgent>(table); };
+    }
+    if (name == "farthest") return [] { return std::make_unique<FarthestAgent>(); };
+    if (name == "closest") return [] { return std::make_unique<ClosestAgent>(); };
+    if (name.rfind("search", 0) == 0) {
+        unsigned depth = 0;
+        const char* end = name.data() + name.size();
+        auto [stop, error] = std::from_chars(name.data() + 6, end, depth);
+        if (error != std::errc() || stop != end || depth == 0 || depth > MAX_SEARCH_DEPTH) return nullptr;
+        return [depth] { return std::make_unique<ExpectiminimaxAgent>(depth); };
+    }
+    return nullptr;
+}
+
+
+/************
+ * LOCKSTEP *
+ ************/
+
+// The deterministic agents that `LockstepSimulator` can play, as lane
+// operations on the options: `FarthestAgent` takes the lowest set bit, and
+// `ClosestAgent` the highest.
+enum class LanePolicy { Farthest, Closest };
+
+[[ nodiscard ]] AgentFactory lanePolicyAgent(LanePolicy policy) {
+    if (policy == LanePolicy::Farthest) return [] { return std::make_unique<FarthestAgent>(); };
+    return [] { return std::make_unique<ClosestAgent>(); };
+}
+
+
+// Plays many games between two `LanePolicy`s at once, one per lane, every lane
+// advancing by a roll per step.
+//
+// The lanes are structure-of-arrays: each half of a packed `GameState` (see
+// PACKED STATE), self to move, and the next 32 rolls of the game as nibbles.
+// A step is then the same straight-line code for every lane (AVX2, eight lanes
+// at a time, if the CPU has it): move generation, the policy, `apply`, and
+// passing the turn are all selects rather than branches. Dice are dealt a
+// Philox block at a time, in bulk for every lane that ran out. When a game
+// ends, its lane starts the next one.
+//
+// Game g rolls `PhiloxDice(seed, g)`, so it plays out exactly as `playOneGame`
+// with those dice, and `runLockstep` matches `runTournament<PhiloxDice>`.
+class LockstepSimulator {
+public:
+    LockstepSimulator(LanePolicy first, LanePolicy second, uint64_t seed, size_t lanes = 1024,
+                      BatchIsa isa = BATCH_ISA)
+        : _farthestFirst(first == LanePolicy::Farthest), _farthestSecond(second == LanePolicy::Farthest),
+          _seed(seed), _isa(isa), _lanes(lanes), _self(lanes), _other(lanes), _rolled(lanes),
+          _rolls{std::vector<uint32_t>(lanes), std::vector<uint32_t>(lanes),
+                 std::vector<uint32_t>(lanes), std::vector<uint32_t>(lanes)},
+          _game(lanes) { /* empty */ }
+
+    // Play games [begin, end), and return how many the first player won.
+    uint64_t play(uint64_t begin, uint64_t end) {
+        _next = begin;
+        _end = end;
+        uint64_t firstWins = 0;
+        _active = _lanes;
+        for (size_t lane = 0; lane < _lanes; ++lane) _start(lane);
+        while (_playing > 0) {
+            _deal();
+            if (_playing <= _active / 2) _compact();
+            size_t done = 0;
+#if defined(__x86_64__)
+            if (_isa == BatchIsa::Avx2) done = _stepAvx2();
+#endif
+            _step(done);
+            // The side that just bore off its last tile has passed the turn.
+            for (uint32_t lane : _over) {
+                firstWins += _other[lane] >> 31;
+                --_playing;
+                _start(lane);
+            }
+            _over.clear();
+        }
+        return firstWins;
+    }
+
+private:
+    static constexpr uint64_t _PARKED = UINT64_MAX;
+
+    // Start the next game in `lane`, or park it if there are none left. A
+    // parked lane has a tile in its pile but none on the board, so it never
+    // moves and never finishes.
+    void _start(size_t lane) {
+        if (_next == _end) {
+            _game[lane] = _PARKED;
+            _self[lane] = _other[lane] = 1 << REMAINING_SHIFT;
+            return;
+        }
+        const uint32_t start = packSide(START);
+        _game[lane] = _next++;
+        _self[lane] = start | HALF_FIRST;
+        _other[lane] = start;
+        _rolled[lane] = 0;
+        _needDice.push_back(lane);
+        ++_playing;
+    }
+
+    // Move the lanes still playing to the front, so that once games run out,
+    // parked lanes stop being stepped. Pre: no lanes are waiting on anything.
+    void _compact() {
+        size_t to = 0;
+        for (size_t from = 0; from < _active; ++from) {
+            if (_game[from] == _PARKED) continue;
+            _self[to] = _self[from];
+            _other[to] = _other[from];
+            _rolled[to] = _rolled[from];
+            for (size_t word = 0; word < 4; ++word) _rolls[word][to] = _rolls[word][from];
+            _game[to++] = _game[from];
+        }
+        for (size_t lane = to; lane < _active; ++lane) _game[lane] = _PARKED;
+        _active = to;
+    }
+
+    // Deal the next block of rolls to every lane that has run out.
+    void _deal() {
+        _dealGames.clear();
+        _dealIndices.clear();
+        _dealLanes.clear();
+        for (uint32_t lane : _needDice) {
+            if (_game[lane] == _PARKED) continue;
+            _dealGames.push_back(_game[lane]);
+            _dealIndices.push_back(_rolled[lane] / PhiloxDice::ROLLS_PER_BLOCK);
+            _dealLanes.push_back(lane);
+        }
+        _needDice.clear();
+        _blocks.resize(_dealLanes.size());
+        PhiloxDice::blocks(_seed, _dealGames.data(), _dealIndices.data(), _dealLanes.size(), _blocks.data());
+        for (size_t i = 0; i < _dealLanes.size(); ++i) {
+            for (size_t word = 0; word < 4; ++word) {
+                _rolls[word][_dealLanes[i]] = PhiloxDice::nibbleCounts(_blocks[i][word]);
+            }
+        }
+    }
+
+    // Note the end of a step for `lane`, given the side not to move next.
+    void _finish(size_t lane, uint32_t other) {
+        if ((other & (HALF_OCCUPIED | HALF_REMAINING)) == 0) _over.push_back(lane);
+        else if (_rolled[lane] % PhiloxDice::ROLLS_PER_BLOCK == 0) _needDice.push_back(lane);
+    }
+
+    // Take a step in lanes [begin, _active), one at a time.
+    void _step(size_t begin) {
+        for (size_t lane = begin; lane < _active; ++lane) {
+            uint32_t self = _self[lane], other = _other[lane];
+            const uint32_t steps = _rolls[0][lane] & 0xF;
+            for (size_t word = 0; word < 3; ++word) {
+                _rolls[word][lane] = _rolls[word][lane] >> 4 | _rolls[word + 1][lane] << 28;
+            }
+            _rolls[3][lane] >>= 4;
+            ++_rolled[lane];
+
+            const uint32_t occupied = self & 0x7FFF;
+            const uint32_t options = occupied & ~(occupied >> steps) & ~(other & 0x0100) & 0xFFFF >> steps;
+            bool again = false;
+            if (options != 0) {
+                const bool farthest = self & HALF_FIRST ? _farthestFirst : _farthestSecond;
+                const uint32_t start = farthest ? __builtin_ctz(options) : 31 - __builtin_clz(options);
+                const uint32_t end = start + steps;
+                self -= start == 0 ? 1 << REMAINING_SHIFT : 1 << start;
+                if ((self & HALF_REMAINING) == 0) self &= ~1u;
+                self |= 1 << end & 0x7FFF;
+                const uint32_t hit = other & 0x1FE0 & 1 << end;
+                if (hit) other = ((other ^ hit) + (1 << REMAINING_SHIFT)) | 1;
+                again = end == 4 || end == 8 || end == 14;
+            }
+            if (!again) std::swap(self, other);
+            _self[lane] = self;
+            _other[lane] = other;
+            _finish(lane, other);
+        }
+    }
+
+#if defined(__x86_64__)
+    // Take a step in as many whole vectors of lanes as there are, from lane 0,
+    // and return where they stopped. This is `_step`, eight lanes at a time.
+    __attribute__((target("avx2")))
+    size_t _stepAvx2() {
+        const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1);
+        const __m256i nibble = _mm256_set1_epi32(0xF), path = _mm256_set1_epi32(0x7FFF);
+        const __m256i board = _mm256_set1_epi32(0xFFFF), rosette = _mm256_set1_epi32(0x0100);
+        const __m256i shared = _mm256_set1_epi32(0x1FE0), pile = _mm256_set1_epi32(1 << REMAINING_SHIFT);
+        const __m256i remaining = _mm256_set1_epi32(HALF_REMAINING);
+        const __m256i complete = _mm256_set1_epi32(HALF_OCCUPIED | HALF_REMAINING);
+        const __m256i block = _mm256_set1_epi32(PhiloxDice::ROLLS_PER_BLOCK - 1);
+        const __m256i farthestFirst = _mm256_set1_epi32(_farthestFirst ? -1 : 0);
+        const __m256i farthestSecond = _mm256_set1_epi32(_farthestSecond ? -1 : 0);
+        // Stores through these can't alias the vectors themselves.
+        uint32_t* const selves = _self.data();
+        uint32_t* const others = _other.data();
+        uint32_t* const rolleds = _rolled.data();
+        uint32_t* const rolls[4] = {_rolls[0].data(), _rolls[1].data(), _rolls[2].data(), _rolls[3].data()};
+
+        size_t lane = 0;
+        for (; lane + 8 <= _active; lane += 8) {
+            __m256i self = _load(selves + lane), other = _load(others + lane);
+            __m256i words[4] = {_load(rolls[0] + lane), _load(rolls[1] + lane),
+                                _load(rolls[2] + lane), _load(rolls[3] + lane)};
+            const __m256i steps = _mm256_and_si256(words[0], nibble);
+            for (size_t word = 0; word < 3; ++word) {
+                _store(rolls[word] + lane, _mm256_or_si256(_mm256_srli_epi32(words[word], 4),
+                                                          _mm256_slli_epi32(words[word + 1], 28)));
+            }
+            _store(rolls[3] + lane, _mm256_srli_epi32(words[3], 4));
+            const __m256i rolled = _mm256_add_epi32(_load(rolleds + lane), one);
+            _store(rolleds + lane, rolled);
+
+            // Move generation, as in `getOptionsBatch`.
+            const __m256i occupied = _mm256_and_si256(self, path);
+            __m256i options = _mm256_andnot_si256(_mm256_srlv_epi32(occupied, steps), occupied);
+            options = _mm256_andnot_si256(_mm256_and_si256(other, rosette), options);
+            options = _mm256_and_si256(options, _mm256_srlv_epi32(board, steps));
+            const __m256i stuck = _mm256_cmpeq_epi32(options, zero);
+
+            // The policy: the lowest or highest option, by who's moving.
+            const __m256i lowest = _log2(_mm256_and_si256(options, _mm256_sub_epi32(zero, options)));
+            const __m256i highest = _log2(options);
+            const __m256i farthest = _mm256_blendv_epi8(farthestSecond, farthestFirst, _mm256_srai_epi32(self, 31));
+            const __m256i start = _mm256_blendv_epi8(highest, lowest, farthest);
+            const __m256i end = _mm256_add_epi32(start, steps);
+
+            // `apply`, as in `lookupApply`.
+            __m256i moved = _mm256_sub_epi32(self, _mm256_blendv_epi8(_mm256_sllv_epi32(one, start), pile,
+                                                                      _mm256_cmpeq_epi32(start, zero)));
+            const __m256i emptied = _mm256_cmpeq_epi32(_mm256_and_si256(moved, remaining), zero);
+            moved = _mm256_andnot_si256(_mm256_and_si256(emptied, one), moved);
+            const __m256i landing = _mm256_sllv_epi32(one, end);
+            moved = _mm256_or_si256(moved, _mm256_and_si256(landing, path));
+            const __m256i hit = _mm256_and_si256(_mm256_and_si256(landing, shared), other);
+            const __m256i missed = _mm256_cmpeq_epi32(hit, zero);
+            const __m256i captured = _mm256_or_si256(
+                _mm256_add_epi32(_mm256_xor_si256(other, hit), _mm256_andnot_si256(missed, pile)),
+                _mm256_andnot_si256(missed, one));
+            __m256i again = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(end, _mm256_set1_epi32(4)),
+                                                            _mm256_cmpeq_epi32(end, _mm256_set1_epi32(8))),
+                                            _mm256_cmpeq_epi32(end, _mm256_set1_epi32(14)));
+            self = _mm256_blendv_epi8(moved, self, stuck);
+            other = _mm256_blendv_epi8(captured, other, stuck);
+            again = _mm256_andnot_si256(stuck, again);
+
+            // Pass the turn, unless going again.
+            _store(selves + lane, _mm256_blendv_epi8(other, self, again));
+            const __m256i next = _mm256_blendv_epi8(self, other, again);
+            _store(others + lane, next);
+
+            unsigned over = _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_and_si256(next, complete), zero)));
+            unsigned dry = _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_and_si256(rolled, block), zero))) & ~over;
+            for (; over != 0; over &= over - 1) _over.push_back(lane + __builtin_ctz(over));
+            for (; dry != 0; dry &= dry - 1) _needDice.push_back(lane + __builtin_ctz(dry));
+        }
+        return lane;
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i _load(const uint32_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    __attribute__((target("avx2")))
+    static void _store(uint32_t* p, __m256i x) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x);
+    }
+    // The index of the highest set bit of each lane (up to bit 23), by way of
+    // its exponent as a float.
+    __attribute__((target("avx2")))
+    static __m256i _log2(__m256i x) {
+        return _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(x)), 23),
+                                _mm256_set1_epi32(127));
+    }
+#endif
+
+    const bool _farthestFirst, _farthestSecond;
+    const uint64_t _seed;
+    const BatchIsa _isa;
+    const size_t _lanes;
+
+    // The lanes.
+    std::vector<uint32_t> _self, _other;  // The halves of a `GameState`, self to move.
+    std::vector<uint32_t> _rolled;  // How many rolls the game has had.
+    std::array<std::vector<uint32_t>, 4> _rolls;  // The rest of the current block, a nibble per roll.
+    std::vector<uint64_t> _game;  // Which game is being played, or `_PARKED`.
+
+    uint64_t _next = 0, _end = 0;  // The games yet to be started.
+    size_t _active = 0;  // How many lanes are stepped; the rest are all parked.
+    size_t _playing = 0;  // How many of those aren't parked.
+    std::vector<uint32_t> _over, _needDice;  // Lanes whose game is over, or that are out of rolls.
+    std::vector<uint64_t> _dealGames, _dealIndices;
+    std::vector<uint32_t> _dealLanes;
+    std::vector<PhiloxDice::Block> _blocks;
+};
+
+
+// Play `games` games between two `LanePolicy`s on `threads` threads, each with
+// its own `LockstepSimulator`, spread over them like `runTournament` (with the
+// same result for the same seed, given `PhiloxDice`).
+TournamentResult runLockstep(LanePolicy first, LanePolicy second, uint64_t games, uint64_t seed,
+                             unsigned threads = std::max(1u, std::thread::hardware_concurrency()),
+                             BatchIsa isa = BATCH_ISA) {
+    struct alignas(64) Tally { uint64_t games = 0, firstWins = 0; };
+    std::vector<Tally> tallies(threads);
+
+    TournamentResult result;
+    result.seconds = timeIt([&] {
+        // Big chunks, since every lane but one idles while the last game of a
+        // chunk finishes.
+        workStealing(games, threads, 1 << 16, [&](unsigned w) {
+            return [&, w, simulator = LockstepSimulator(first, second, seed, 1024, isa)](
+                    uint64_t begin, uint64_t end) mutable {
+                tallies[w].firstWins += simulator.play(begin, end);
+                tallies[w].games += end - begin;
+            };
+        });
+    });
+    for (const Tally& tally : tallies) {
+        result.games += tally.games;
+        result.firstWins += tally.firstWins;
+    }
+    return result;
+}
+
+
+// Check that lockstep games, with every kernel this CPU can run and with
+// lanes left over after the last whole vector, play out as `playOneGame`.
+bool _verifyLockstep() {
+    const uint64_t games = 2000, seed = 11;
+    for (LanePolicy first : {LanePolicy::Farthest, LanePolicy::Closest}) {
+        for (LanePolicy second : {LanePolicy::Farthest, LanePolicy::Closest}) {
+            std::unique_ptr<Agent> one = lanePolicyAgent(first)(), two = lanePolicyAgent(second)();
+            uint64_t expected = 0;
+            for (uint64_t game = 0; game < games; ++game) {
+                expected += playOneGame(one, two, PhiloxDice(seed, game));
+            }
+            for (BatchIsa isa : {BatchIsa::Scalar, BatchIsa::Avx2}) {
+                if (isa > BATCH_ISA) break;
+                LockstepSimulator simulator(first, second, seed, 61, isa);
+                if (simulator.play(0, games / 2) + simulator.play(games / 2, games) != expected) return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/************
+ * MATCHUPS *
+ ************/
+
+// The value of a position under fixed policies for agents A and B, split into
+// the rolls that move and the rolls that pass, like `backupMoves`.
+//
+// Here every value is the probability that A goes on to win, whoever is to
+// move, so there's a value for each position with A to move and another with
+// B to move. `aToMove` says which one this is, i.e. whose side `self` is, and
+// `value(state, aToMove)` should look up the current value of any position.
+// `choose(state, steps, options, aToMove, value)` gives the move the mover
+// makes; like `playOneRoll`, an invalid move passes the turn. So the value of
+// the position is::
+//
+//     moves + pass * value(swapped(state), !aToMove)
+template <typename Choose, typename Lookup>
+[[ nodiscard ]] Backup backupPolicy(GameState state, bool aToMove, Choose&& choose, Lookup&& value) {
+    if ((state.bits & (HALF_OCCUPIED | HALF_REMAINING)) == 0) return {float(aToMove), 0};
+    if (isOver(state)) return {float(!aToMove), 0};
+
+    unsigned pass = ROLL_WEIGHTS[0];
+    float moves = 0;
+    for (Steps steps = 1; steps <= 4; ++steps) {
+        Options options = getOptions(state, steps);
+        Position start = options.none() ? Agent::INVALID : choose(state, steps, options, aToMove, value);
+        if (start == Agent::INVALID || !options.test(start)) {
+            pass += ROLL_WEIGHTS[steps];
+            continue;
+        }
+        GameState next = state;
+        bool again = apply(next, start, steps);
+        moves += ROLL_WEIGHTS[steps] * (again ? value(next, aToMove) : value(swapped(next), !aToMove));
+    }
+    return {moves / 16, pass / 16.0f};
+}
+
+
+// The values of one layer of positions (see `Layer`) with A to move, and with
+// B to move.
+struct MatchupLayer {
+    Layer a, b;
+
+    MatchupLayer() { /* empty */ }
+    explicit MatchupLayer(unsigned total) : a(total), b(total) { /* empty */ }
+};
+
+
+// Look up the value of any position in `layer` or the `next` one, with A or B
+// to move, for `backupPolicy`.
+inline auto _matchupValue(const MatchupLayer& layer, const MatchupLayer& next) {
+    return [&layer, &next](GameState state, bool aToMove) {
+        Rank index = rank(state);
+        const MatchupLayer& values = index < layer.a.end ? layer : next;
+        return (aToMove ? values.a : values.b)[index];
+    };
+}
+
+
+// Compute the value of every position in `layer` under fixed policies by value
+// iteration, given the values of the `next` layer, as `solveLayer` does for
+// optimal play.
+//
+// `makeChoose()` is called for every chunk of positions on every thread, and
+// must return a fresh `choose` for `backupPolicy`, so that stateful agents
+// needn't be shared between threads.
+//
+// Passing still links the two layers: A's pass from a position lands on B to
+// move at its swapped twin, and vice versa. So each such pair is updated
+// together, by solving its two equations exactly.
+template <typename MakeChoose>
+void evaluateLayer(unsigned total, MatchupLayer& layer, const MatchupLayer& next, float tolerance,
+                   MakeChoose&& makeChoose) {
+    const Rank begin = layer.a.begin, end = layer.a.end, size = end - begin;
+    parallelChunks(size, 1 << 16, [&](Rank first, Rank last) {
+        for (Rank index = first; index < last; ++index) {
+            layer.a.values[index].store(0.5, std::memory_order_relaxed);
+            layer.b.values[index].store(0.5, std::memory_order_relaxed);
+        }
+    });
+    auto value = _matchupValue(layer, next);
+
+    for (size_t sweep = 1; ; ++sweep) {
+        std::mutex mutex;
+        float delta = 0;
+        double seconds = timeIt([&] {
+            parallelChunks(size, 1 << 14, [&](Rank first, Rank last) {
+                auto choose = makeChoose();
+                float local = 0;
+                auto update = [&](Layer& values, Rank index, float updated) {
+                    std::atomic<float>& stored = values.values[index - begin];
+                    local = std::max(local, std::abs(updated - stored.load(std::memory_order_relaxed)));
+                    stored.store(updated, std::memory_order_relaxed);
+                };
+                for (Rank index = end - first; index-- > end - last; ) {
+                    // Solve x = a + c y and y = b + d x for A to move here (x)
+                    // and B to move at the twin (y). B to move here is paired
+                    // with A to move at the twin, and is solved from there.
+                    GameState state = unrank(index, true);
+                    Rank twin = rank(swapped(state));
+                    Backup self = backupPolicy(state, true, choose, value);
+                    Backup other = backupPolicy(swapped(state), false, choose, value);
+                    float x = (self.moves + self.pass * other.moves) / (1 - self.pass * other.pass);
+                    update(layer.a, index, x);
+                    update(layer.b, twin, other.moves + other.pass * x);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                delta = std::max(delta, local);
+            });
+        });
+        std::cout << "Layer " << total << ", sweep " << sweep << ": max delta " << delta
+                  << " (" << seconds << "s)" << std::endl;
+        if (delta <= tolerance) break;
+    }
+}
+
+
+// The exact outcome of a matchup between two fixed agents.
+struct Matchup {
+    double aFirst;  // The probability that A wins, moving first.
+    double bFirst;  // The probability that A wins, moving second.
+};
+
+
+// Evaluate the policies given by `makeChoose` (see `evaluateLayer`) over the
+// whole game, from the end backwards, a layer at a time, and return how often
+// A wins from the start. `solved(layer)` is called with each layer once its
+// values are final, along with the (final) layer after it.
+template <typename MakeChoose, typename Solved>
+Matchup evaluatePolicies(MakeChoose&& makeChoose, float tolerance, Solved&& solved) {
+    MatchupLayer next;
+    for (unsigned total = 2 * TILES + 1; total-- > 0; ) {
+        MatchupLayer layer(total);
+        evaluateLayer(total, layer, next, tolerance, makeChoose);
+        solved(layer, next);
+        next = std::move(layer);
+    }
+    Rank start = rank(START, START);
+    return {next.a[start], next.b[start]};
+}
+
+
+// A `choose` (see `backupPolicy`) for a fixed agent.
+inline Position _agentMove(const std::unique_ptr<Agent>& agent, GameState state, Steps steps, Options options) {
+    return agent->getMove(selfSide(state), otherSide(state), steps, options);
+}
+
+// A `choose` for A playing a best response: the move with the best value for A.
+template <typename Lookup>
+Position _bestMove(GameState state, Steps steps, Options options, Lookup&& value) {
+    Position move = Agent::INVALID;
+    float best = -1;
+    for (unsigned long bits = options.to_ulong(); bits != 0; bits &= bits - 1) {
+        GameState next = state;
+        Position start = __builtin_ctzl(bits);
+        bool again = apply(next, start, steps);
+        float updated = again ? value(next, true) : value(swapped(next), false);
+        if (updated > best) {
+            best = updated;
+            move = start;
+        }
+    }
+    return move;
+}
+
+
+// Compute exactly how often agent A beats agent B, as the absorption
+// probabilities of the Markov chain that their policies and the dice drive
+// over every position, rather than by sampling games.
+//
+// The agents must be deterministic, i.e. always make the same move from the
+// same position. Every thread asks its own agents, made by the factories.
+Matchup evaluateMatchup(const AgentFactory& agentA, const AgentFactory& agentB, float tolerance = 1e-6) {
+    auto makeChoose = [&] {
+        return [a = agentA(), b = agentB()](GameState state, Steps steps, Options options, bool aToMove, auto&&) {
+            return _agentMove(aToMove ? a : b, state, steps, options);
+        };
+    };
+    return evaluatePolicies(makeChoose, tolerance, [](const MatchupLayer&, const MatchupLayer&) { /* empty */ });
+}
+
+
+// Compute the best response to a fixed (deterministic) agent, i.e. the policy
+// that beats it most often, and how often that is, by value iteration in which
+// only A maximizes and B's moves come from its agent.
+//
+// If given, the best response's move for every roll from every position is
+// written to `policy`, for `PolicyAgent` to play.
+Matchup bestResponse(const AgentFactory& opponent, TablebaseWriter* policy = nullptr, float tolerance = 1e-6) {
+    auto makeChoose = [&] {
+        return [b = opponent()](GameState state, Steps steps, Options options, bool aToMove, auto&& value) {
+            return aToMove ? _bestMove(state, steps, options, value) : _agentMove(b, state, steps, options);
+        };
+    };
+    return evaluatePolicies(makeChoose, tolerance, [&](const MatchupLayer& layer, const MatchupLayer& next) {
+        if (!policy) return;
+        auto value = _matchupValue(layer, next);
+        policy->writeEntries(layer.a.begin, layer.a.end, [&](Rank index) {
+            GameState state = unrank(index, true);
+            uint16_t entry = 0;
+            for (Steps steps = 1; steps <= 4; ++steps) {
+                Options options = getOptions(state, steps);
+                Position move = options.none() ? Agent::INVALID : _bestMove(state, steps, options, value);
+                entry |= move << (4 * (steps - 1));
+            }
+            return entry;
+        });
+    });
+}
+
+
+// The exact distribution of the length of a game between two fixed agents.
+struct GameLengths {
+    std::vector<double> probability;  // Of a game lasting exactly so many rolls.
+    double aWins = 0;  // The probability that A (the first player) wins.
+    double truncated = 0;  // The probability mass dropped along the way.
+    size_t widest = 0;  // The most positions in play after any one roll.
+
+    [[ nodiscard ]] double mean() const {
+        double sum = 0;
+        for (size_t rolls = 0; rolls < probability.size(); ++rolls) sum += rolls * probability[rolls];
+        return sum;
+    }
+    [[ nodiscard ]] double variance() const {
+        double sum = 0, average = mean();
+        for (size_t rolls = 0; rolls < probability.size(); ++rolls) {
+            sum += (rolls - average) * (rolls - average) * probability[rolls];
+        }
+        return sum;
+    }
+    // The fewest rolls by which a game is over with probability at least `p`.
+    [[ nodiscard ]] size_t percentile(double p) const {
+        double sum = 0;
+        for (size_t rolls = 0; rolls < probability.size(); ++rolls) {
+            if ((sum += probability[rolls]) >= p) return rolls;
+        }
+        return probability.size();
+    }
+};
+
+
+// Compute the exact distribution of the length (in rolls) of a game between
+// two fixed agents, A moving first, by pushing the probability of every
+// position forward a roll at a time from the start.
+//
+// The positions in play after each roll are kept sorted by their packed bits
+// (whose first-player bit says whose turn it is). After each roll, the least
+// probable of them are dropped, up to `tolerance` times the probability still
+// in play, so that the long tail of improbable positions doesn't hold up the
+// rest, and once less than `tolerance` is left in play, it's all dropped. So
+// at most `tolerance` times the mean length (plus one) is dropped in all.
+//
+// The tail still spreads over millions of positions, so no more than `width`
+// (the most probable) are kept in play, which bounds the memory to about 200
+// bytes a position. Either way, the total dropped bounds the error.
+//
+// As for `evaluateMatchup`, the agents must be deterministic, and every chunk
+// of positions asks its own agents, made by the factories.
+GameLengths gameLengths(const AgentFactory& agentA, const AgentFactory& agentB, double tolerance = 1e-9,
+                        size_t width = 1 << 20) {
+    using Mass = std::pair<uint64_t, double>;  // The bits of a position and its probability.
+    auto byBits = [](const Mass& x, const Mass& y) { return x.first < y.first; };
+    // Sum the probability of each position in sorted `masses` into `out`.
+    auto merge = [](const std::vector<Mass>& masses, std::vector<Mass>& out) {
+        for (const Mass& entry : masses) {
+            if (!out.empty() && out.back().first == entry.first) out.back().second += entry.second;
+            else out.push_back(entry);
+        }
+    };
+    GameLengths lengths;
+    std::vector<Mass> current = {{pack(START, START, true).bits, 1}};
+    lengths.probability.push_back(0);
+
+    const auto begin = std::chrono::steady_clock::now();
+    while (!current.empty()) {
+        std::mutex mutex;
+        std::vector<Mass> next;
+        double ended = 0, aWins = 0;
+        parallelChunks(current.size(), 1 << 12, [&](uint64_t begin, uint64_t end) {
+            std::unique_ptr<Agent> a = agentA(), b = agentB();
+            std::vector<Mass> local, merged;
+            double localEnded = 0, localAWins = 0;
+            for (uint64_t i = begin; i < end; ++i) {
+                const GameState state{current[i].first};
+                const bool aToMove = firstToMove(state);
+                for (Steps steps = 0; steps <= 4; ++steps) {
+                    const double mass = current[i].second * ROLL_WEIGHTS[steps] / 16;
+                    Options options = steps == 0 ? Options() : getOptions(state, steps);
+                    Position start = options.none() ? Agent::INVALID
+                                   : (aToMove ? a : b)->getMove(selfSide(state), otherSide(state), steps, options);
+                    GameState successor = state;
+                    if (start == Agent::INVALID || !options.test(start) || !apply(successor, start, steps)) {
+                        successor = swapped(successor);
+                    }
+                    if (isOver(successor)) {
+                        localEnded += mass;
+                        localAWins += aToMove ? mass : 0;  // The mover just won.
+                    }
+                    else local.emplace_back(successor.bits, mass);
+                }
+            }
+            // A roll of zero and a roll with no options lead to the same
+            // position, so merging here saves much of the room in `next`.
+            std::sort(local.begin(), local.end(), byBits);
+            merge(local, merged);
+            std::lock_guard<std::mutex> lock(mutex);
+            next.insert(next.end(), merged.begin(), merged.end());
+            ended += localEnded;
+            aWins += localAWins;
+        });
+        lengths.probability.push_back(ended);
+        lengths.aWins += aWins;
+
+        // Merge the probability of each position...
+        std::sort(next.begin(), next.end(), byBits);
+        current.clear();
+        merge(next, current);
+        std::vector<Mass>().swap(next);
+        double remaining = 0;
+        for (const Mass& entry : current) remaining += entry.second;
+
+        // ...then find the least probable ones we can afford to drop, and drop
+        // everything less probable than the first we can't, or than the
+        // `width` most probable. Games can go on forever, so once there's
+        // hardly anything left in play, drop it all.
+        if (remaining <= tolerance) {
+            lengths.truncated += remaining;
+            break;
+        }
+        std::vector<double> masses(current.size());
+        for (size_t i = 0; i < current.size(); ++i) masses[i] = current[i].second;
+        std::sort(masses.begin(), masses.end());
+        double budget = tolerance * remaining, cutoff = 0;
+        for (double mass : masses) {
+            if ((budget -= mass) < 0) break;
+            cutoff = mass;
+        }
+        if (masses.size() > width) cutoff = std::max(cutoff, masses[masses.size() - width]);
+        auto kept = std::remove_if(current.begin(), current.end(), [&](const Mass& entry) {
+            if (entry.second >= cutoff) return false;
+            lengths.truncated += entry.second;
+            remaining -= entry.second;
+            return true;
+        });
+        current.erase(kept, current.end());
+        lengths.widest = std::max(lengths.widest, current.size());
+
+        const size_t rolls = lengths.probability.size() - 1;
+        if (rolls % 16 == 0) {
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - begin;
+            std::cout << "Roll " << rolls << ": " << current.size() << " positions hold " << remaining
+                      << " of the probability (" << seconds.count() << "s)" << std::endl;
+        }
+    }
+    return lengths;
+}
+
+
+/**************
+ * BENCHMARKS *
+ **************/
+
+// A fixed, pre-rolled dice sequence, so benchmarks measure the game and not the
+// random number generator. The length is a power of two for cheap wrapping.
+std::vector<Steps> makeRollTape(size_t length) {
+    std::mt19937 gen(0x0C0FFEE);
+    std::binomial_distribution<Steps> d(4, 0.5);
+    std::vector<Steps> tape(length);
+    for (Steps& steps : tape) steps = d(gen);
+    return tape;
+}
+
+// Compare a farthest-first playout on a pair of `Side`s against one on a
+// `GameState`. Both consume the same rolls, so they must agree exactly.
+void benchState() {
+    const size_t games = 200000;
+    const std::vector<Steps> tape = makeRollTape(1 << 16);
+    const size_t mask = tape.size() - 1;
+
+    uint64_t sideRolls = 0, sideWins = 0;
+    double sideSeconds = timeIt([&] {
+        size_t k = 0;
+        for (size_t i = 0; i < games; ++i) {
+            Side left = START, right = START;
+            bool current = true;
+            while (left != COMPLETE && right != COMPLETE) {
+                Side& self = current ? left : right;
+                Side& other = current ? right : left;
+                Steps steps = tape[k++ & mask];
+                bool again = false;
+                if (steps != 0) {
+                    Options options = getOptions(self, other, steps);
+                    if (options.any()) {
+                        again = apply(self, other, __builtin_ctzl(options.to_ulong()), steps).again;
+                    }
+                }
+                current = !(current ^ again);
+                ++sideRolls;
+            }
+            sideWins += left == COMPLETE;
+        }
+    });
+
+    uint64_t stateRolls = 0, stateWins = 0;
+    double stateSeconds = timeIt([&] {
+        size_t k = 0;
+        for (size_t i = 0; i < games; ++i) {
+            GameState state = pack(START, START, true);
+            while (!isOver(state)) {
+                Steps steps = tape[k++ & mask];
+                bool again = false;
+                if (steps != 0) {
+                    Options options = getOptions(state, steps);
+                    if (options.any()) {
+                        again = apply(state, __builtin_ctzl(options.to_ulong()), steps);
+                    }
+                }
+                if (!again) state = swapped(state);
+                ++stateRolls;
+            }
+            // The loser is always the one left to move.
+            stateWins += !firstToMove(state);
+        }
+    });
+
+    uint64_t tableRolls = 0, tableWins = 0;
+    double tableSeconds = timeIt([&] {
+        size_t k = 0;
+        for (size_t i = 0; i < games; ++i) {
+            GameState state = pack(START, START, true);
+            while (!isOver(state)) {
+                Steps steps = tape[k++ & mask];
+                bool again = false;
+                if (steps != 0) {
+                    Options options = lookupOptions(state, steps);
+                    if (options.any()) {
+                        again = lookupApply(state, __builtin_ctzl(options.to_ulong()), steps);
+                    }
+                }
+                if (!again) state = swapped(state);
+                ++tableRolls;
+            }
+            tableWins += !firstToMove(state);
+        }
+    });
+
+    // Specialized on the roll, switching on it once per turn.
+    uint64_t templateRolls = 0, templateWins = 0;
+    double templateSeconds = timeIt([&] {
+        size_t k = 0;
+        for (size_t i = 0; i < games; ++i) {
+            GameState state = pack(START, START, true);
+            while (!isOver(state)) {
+                Steps steps = tape[k++ & mask];
+                bool again = steps != 0 && withSteps(steps, [&](auto s) {
+                    Options options = getOptions<s>(state);
+                    return options.any() && apply<s>(state, __builtin_ctzl(options.to_ulong()));
+                });
+                if (!again) state = swapped(state);
+                ++templateRolls;
+            }
+            templateWins += !firstToMove(state);
+        }
+    });
+
+    // Move generation alone, over positions from all over the space.
+    std::vector<GameState> states(1 << 12);
+    for (size_t i = 0; i < states.size(); ++i) states[i] = unrank(i * (RANK_COUNT / states.size()), true);
+    const size_t repeats = 1 << 10;
+    uint64_t twiddled = 0, looked = 0;
+    double twiddleSeconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            for (GameState state : states) {
+                for (Steps steps = 1; steps <= 4; ++steps) twiddled += getOptions(state, steps).to_ulong();
+            }
+        }
+    });
+    double lookupSeconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            for (GameState state : states) {
+                for (Steps steps = 1; steps <= 4; ++steps) looked += lookupOptions(state, steps).to_ulong();
+            }
+        }
+    });
+
+    std::cout << "state: Side pair   " << sideRolls / sideSeconds / 1e6 << " M rolls/s" << std::endl;
+    std::cout << "state: GameState   " << stateRolls / stateSeconds / 1e6 << " M rolls/s" << std::endl;
+    std::cout << "state: + tables    " << tableRolls / tableSeconds / 1e6 << " M rolls/s" << std::endl;
+    std::cout << "state: + templates " << templateRolls / templateSeconds / 1e6 << " M rolls/s" << std::endl;
+    std::cout << "state: getOptions  " << 4 * repeats * states.size() / twiddleSeconds / 1e6 << " M/s" << std::endl;
+    std::cout << "state: lookup      " << 4 * repeats * states.size() / lookupSeconds / 1e6 << " M/s" << std::endl;
+    if (sideRolls != stateRolls || sideWins != stateWins || tableRolls != stateRolls || tableWins != stateWins
+            || templateRolls != stateRolls || templateWins != stateWins || twiddled != looked) {
+        std::cout << "state: MISMATCH between representations!" << std::endl;
+    }
+}
+
+// Play `games` games in which both players always take the first option,
+// rolling with `roll()`, and return how many the first player won.
+template <typename Roll>
+uint64_t _simulate(size_t games, Roll&& roll) {
+    uint64_t wins = 0;
+    for (size_t i = 0; i < games; ++i) {
+        GameState state = pack(START, START, true);
+        while (!isOver(state)) {
+            Steps steps = roll();
+            bool again = false;
+            if (steps != 0) {
+                Options options = getOptions(state, steps);
+                if (options.any()) again = apply(state, __builtin_ctzl(options.to_ulong()), steps);
+            }
+            if (!again) state = swapped(state);
+        }
+        wins += !firstToMove(state);
+    }
+    return wins;
+}
+
+// Time the dice, alone and in whole games, against std::binomial_distribution.
+void benchDice() {
+    const size_t rolls = 1 << 26;
+    const size_t games = 200000;
+
+    std::mt19937 gen(1);
+    std::binomial_distribution<Steps> binomial(4, 0.5);
+    Dice dice(1);
+
+    uint64_t binomialSum = 0, diceSum = 0;
+    double binomialSeconds = timeIt([&] { for (size_t i = 0; i < rolls; ++i) binomialSum += binomial(gen); });
+    double diceSeconds = timeIt([&] { for (size_t i = 0; i < rolls; ++i) diceSum += dice.roll(); });
+    std::cout << "dice: binomial     " << rolls / binomialSeconds / 1e6 << " M rolls/s" << std::endl;
+    std::cout << "dice: popcount     " << rolls / diceSeconds / 1e6 << " M rolls/s ("
+              << binomialSeconds / diceSeconds << "x)" << std::endl;
+
+    // Counter-based dice, in sequence, at random, and in batches.
+    PhiloxDice philox(1, 0);
+    uint64_t philoxSum = 0, randomSum = 0, batchSum = 0;
+    double philoxSeconds = timeIt([&] { for (size_t i = 0; i < rolls; ++i) philoxSum += philox.roll(); });
+    double randomSeconds = timeIt([&] {
+        for (size_t i = 0; i < rolls / 16; ++i) randomSum += PhiloxDice::rollAt(1, i, i * 0x9E3779B9 % rolls);
+    });
+    std::vector<Steps> batch(1 << 12);
+    double batchSeconds = timeIt([&] {
+        for (size_t i = 0; i < rolls; i += batch.size()) {
+            PhiloxDice::rolls(1, 0, i, batch.size(), batch.data());
+            for (Steps steps : batch) batchSum += steps;
+        }
+    });
+    std::cout << "dice: philox       " << rolls / philoxSeconds / 1e6 << " M rolls/s" << std::endl;
+    std::cout << "dice: philox at    " << rolls / 16 / randomSeconds / 1e6 << " M rolls/s (random access)" << std::endl;
+    std::cout << "dice: philox batch " << rolls / batchSeconds / 1e6 << " M rolls/s" << std::endl;
+    if (philoxSum != batchSum || std::abs(double(philoxSum) - diceSum) > 0.01 * rolls
+        || std::abs(16.0 * randomSum - diceSum) > 0.01 * rolls) {
+        std::cout << "dice: MISMATCH between Philox rolls! (" << philoxSum << " vs " << batchSum
+                  << ", " << randomSum << ")" << std::endl;
+    }
+
+    uint64_t binomialWins = 0, diceWins = 0;
+    binomialSeconds = timeIt([&] { binomialWins = _simulate(games, [&] { return binomial(gen); }); });
+    diceSeconds = timeIt([&] { diceWins = _simulate(games, [&] { return dice.roll(); }); });
+    std::cout << "dice: binomial     " << games / binomialSeconds / 1e3 << " K games/s" << std::endl;
+    std::cout << "dice: popcount     " << games / diceSeconds / 1e3 << " K games/s ("
+              << binomialSeconds / diceSeconds << "x)" << std::endl;
+
+    // Both should average two steps a roll, and win about as often.
+    if (std::abs(double(binomialSum) - diceSum) > 0.01 * rolls ||
+        std::abs(double(binomialWins) - diceWins) > 0.01 * games) {
+        std::cout << "dice: MISMATCH between distributions! (" << binomialSum << " vs " << diceSum
+                  << ", " << binomialWins << " vs " << diceWins << ")" << std::endl;
+    }
+}
+
+// Count the leaves of the game tree `depth` rolls deep, like a chess perft.
+// Every roll is a branch, as is every move for it; a roll with no move passes
+// the turn, and a finished game is a leaf. There are three versions, which
+// must agree: copy-make on a pair of sides, make/unmake on a pair of sides, and
+// copy-make on a packed state.
+uint64_t perftCopy(Side self, Side other, unsigned depth) {
+    if (depth == 0 || self == COMPLETE || other == COMPLETE) return 1;
+    uint64_t leaves = perftCopy(other, self, depth - 1);  // Rolled a zero.
+    for (Steps steps = 1; steps <= 4; ++steps) {
+        Options options = getOptions(self, other, steps);
+        if (options.none()) leaves += perftCopy(other, self, depth - 1);
+        for (Position start = 0; start < 15; ++start) {
+            if (!options.test(start)) continue;
+            Side nextSelf = self, nextOther = other;
+            if (apply(nextSelf, nextOther, start, steps).again) leaves += perftCopy(nextSelf, nextOther, depth - 1);
+            else leaves += perftCopy(nextOther, nextSelf, depth - 1);
+        }
+    }
+    return leaves;
+}
+
+uint64_t perftUndo(Side& self, Side& other, unsigned depth) {
+    if (depth == 0 || self == COMPLETE || other == COMPLETE) return 1;
+    uint64_t leaves = perftUndo(other, self, depth - 1);  // Rolled a zero.
+    for (Steps steps = 1; steps <= 4; ++steps) {
+        Options options = getOptions(self, other, steps);
+        if (options.none()) leaves += perftUndo(other, self, depth - 1);
+        for (Position start = 0; start < 15; ++start) {
+            if (!options.test(start)) continue;
+            Undo move = apply(self, other, start, steps);
+            if (move.again) leaves += perftUndo(self, other, depth - 1);
+            else leaves += perftUndo(other, self, depth - 1);
+            undo(self, other, move);
+        }
+    }
+    return leaves;
+}
+
+uint64_t perftState(GameState state, unsigned depth) {
+    if (depth == 0 || isOver(state)) return 1;
+    uint64_t leaves = perftState(swapped(state), depth - 1);  // Rolled a zero.
+    for (Steps steps = 1; steps <= 4; ++steps) {
+        Options options = getOptions(state, steps);
+        if (options.none()) leaves += perftState(swapped(state), depth - 1);
+        for (Position start = 0; start < 15; ++start) {
+            if (!options.test(start)) continue;
+            GameState next = state;
+            if (!apply(next, start, steps)) next = swapped(next);
+            leaves += perftState(next, depth - 1);
+        }
+    }
+    return leaves;
+}
+
+// Time perft from a handful of positions spread over the whole space, comparing
+// make/unmake against copy-make.
+void benchPerft() {
+    const unsigned depth = 5;
+    const Rank roots = 64;
+    std::vector<std::pair<Side, Side>> positions(roots);
+    for (Rank i = 0; i < roots; ++i) unrank(i * (RANK_COUNT / roots), positions[i].first, positions[i].second);
+
+    uint64_t copyLeaves = 0, undoLeaves = 0, stateLeaves = 0;
+    double copySeconds = timeIt([&] {
+        for (auto [self, other] : positions) copyLeaves += perftCopy(self, other, depth);
+    });
+    double undoSeconds = timeIt([&] {
+        for (auto [self, other] : positions) undoLeaves += perftUndo(self, other, depth);
+    });
+    double stateSeconds = timeIt([&] {
+        for (auto [self, other] : positions) stateLeaves += perftState(pack(self, other, true), depth);
+    });
+
+    std::cout << "perft: " << copyLeaves << " leaves, " << depth << " rolls deep" << std::endl;
+    std::cout << "perft: copy-make   " << copyLeaves / copySeconds / 1e6 << " M leaves/s" << std::endl;
+    std::cout << "perft: make/unmake " << undoLeaves / undoSeconds / 1e6 << " M leaves/s ("
+              << copySeconds / undoSeconds << "x)" << std::endl;
+    std::cout << "perft: GameState   " << stateLeaves / stateSeconds / 1e6 << " M leaves/s ("
+              << copySeconds / stateSeconds << "x)" << std::endl;
+    if (copyLeaves != undoLeaves || copyLeaves != stateLeaves) {
+        std::cout << "perft: MISMATCH between versions!" << std::endl;
+    }
+}
+
+// A decision for an agent to make, with more than one option to choose from.
+struct Decision {
+    Side self, other;
+    Steps steps;
+    Options options;
+};
+
+// Sample about `count` decisions evenly from the whole space.
+std::vector<Decision> sampleDecisions(size_t count) {
+    std::vector<Decision> decisions;
+    for (Rank index = 0; index < RANK_COUNT; index += std::max<Rank>(1, RANK_COUNT / count)) {
+        Decision decision;
+        unrank(index, decision.self, decision.other);
+        decision.steps = 1 + index % 4;
+        decision.options = getOptions(decision.self, decision.other, decision.steps);
+        if (decision.options.count() > 1) decisions.push_back(decision);
+    }
+    return decisions;
+}
+
+// Time ranking and unranking over a cache-resident sample of the whole space.
+void benchRanking() {
+    const Rank sample = 1 << 14;
+    const Rank stride = RANK_COUNT / sample;
+    const size_t repeats = 1 << 10;
+
+    std::vector<Side> sides(2 * sample);
+    Rank unrankSum = 0;
+    double unrankSeconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            for (Rank i = 0; i < sample; ++i) {
+                unrank(i * stride + r, sides[2 * i], sides[2 * i + 1]);
+                unrankSum += sides[2 * i].remaining;
+            }
+        }
+    });
+    Rank rankSum = 0;
+    double rankSeconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            for (Rank i = 0; i < sample; ++i) rankSum += rank(sides[2 * i], sides[2 * i + 1]);
+        }
+    });
+
+    std::cout << "ranking: " << RANK_COUNT << " positions" << std::endl;
+    std::cout << "ranking: rank     " << sample * repeats / rankSeconds / 1e6 << " M/s" << std::endl;
+    std::cout << "ranking: unrank   " << sample * repeats / unrankSeconds / 1e6 << " M/s" << std::endl;
+    if (rankSum != repeats * (stride * (sample - 1) * sample / 2 + sample * (repeats - 1))) {
+        std::cout << "ranking: MISMATCH in round trip! (" << unrankSum << ")" << std::endl;
+    }
+}
+
+// Time batched move generation, with every kernel this CPU can run, against
+// `getOptions` one position at a time, over a cache-resident sample of positions.
+void benchBatch() {
+    const size_t count = 1 << 12;
+    const size_t repeats = 1 << 11;
+    std::vector<GameState> states(count);
+    std::vector<uint16_t> self(count), other(count), options(count);
+    std::vector<Steps> steps(count);
+    const std::vector<Steps> tape = makeRollTape(count);
+    for (size_t i = 0; i < count; ++i) {
+        states[i] = unrank(i * (RANK_COUNT / count), true);
+        self[i] = states[i].bits & HALF_OCCUPIED;
+        other[i] = states[i].bits >> 32 & HALF_OCCUPIED;
+        steps[i] = tape[i];
+    }
+
+    uint64_t expected = 0;
+    double seconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            Steps roll = 1 + r % 4;
+            for (size_t i = 0; i < count; ++i) options[i] = getOptions(states[i], roll).to_ulong();
+            expected += options[r % count];
+        }
+    });
+    uint64_t mixedExpected = 0;
+    double mixedSeconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            for (size_t i = 0; i < count; ++i) options[i] = getOptions(states[i], steps[i]).to_ulong();
+            mixedExpected += options[r % count];
+        }
+    });
+    std::cout << "batch: one at a time    " << count * repeats / seconds / 1e6 << " M/s, a roll each "
+              << count * repeats / mixedSeconds / 1e6 << " M/s" << std::endl;
+
+    for (BatchIsa isa : {BatchIsa::Scalar, BatchIsa::Sse2, BatchIsa::Avx2}) {
+        if (isa > BATCH_ISA) break;
+        uint64_t sum = 0;
+        seconds = timeIt([&] {
+            for (size_t r = 0; r < repeats; ++r) {
+                getOptionsBatch(self.data(), other.data(), Steps(1 + r % 4), options.data(), count, isa);
+                sum += options[r % count];
+            }
+        });
+        uint64_t mixedSum = 0;
+        double mixedSeconds = timeIt([&] {
+            for (size_t r = 0; r < repeats; ++r) {
+                getOptionsBatch(self.data(), other.data(), steps.data(), options.data(), count, isa);
+                mixedSum += options[r % count];
+            }
+        });
+        std::cout << "batch: " << batchIsaName(isa) << std::string(7 - strlen(batchIsaName(isa)), ' ')
+                  << "one roll " << count * repeats / seconds / 1e6 << " M/s, a roll each "
+                  << count * repeats / mixedSeconds / 1e6 << " M/s" << std::endl;
+        if (sum != expected || mixedSum != mixedExpected) {
+            std::cout << "batch: MISMATCH with getOptions!" << std::endl;
+        }
+    }
+}
+
+// Run every benchmark.
+int bench() {
+    benchState();
+    benchBatch();
+    benchDice();
+    benchPerft();
+    benchRanking();
+    return EXIT_SUCCESS;
+}
+
+
+// Run every (exhaustive) self-check.
+int verify() {
+    bool ok = true;
+    auto check = [&ok](const char* name, bool passed) {
+        std::cout << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+        ok &= passed;
+    };
+    check("dice", _verifyDice());
+    check("philox dice", _verifyPhiloxDice());
+    check("zobrist", _verifyZobrist());
+    check("transposition table", _verifyTranspositionTable());
+    check("ranking", _verifyRanking());
+    check("packed state", _verifyPackedState());
+    check("move tables", _verifyMoveTables());
+    check("options batch", _verifyOptionsBatch());
+    check("lockstep", _verifyLockstep());
+    check("game log", _verifyGameLog());
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+// Solve the game and write the value of every position to a tablebase at `path`.
+int solve(const std::string& path) {
+    std::cout << "Solving " << RANK_COUNT << " positions on "
+              << std::max(1u, std::thread::hardware_concurrency()) << " threads." << std::endl;
+    TablebaseWriter writer(path);
+    if (!writer) return EXIT_FAILURE;
+
+    // Solve from the end of the game backwards, a layer at a time. Only the
+    // layer being solved and the one after it are ever held in memory.
+    Layer next;
+    for (unsigned total = 2 * TILES + 1; total-- > 0; ) {
+        Layer layer(total);
+        solveLayer(total, layer, next, 1e-6);
+        if (!writer.write(layer.begin, layer.end, [&](Rank index) { return layer[index]; })) {
+            return EXIT_FAILURE;
+        }
+        next = std::move(layer);
+    }
+    if (!writer.commit()) return EXIT_FAILURE;
+    std::cout << "The first player wins with probability "
+              << next[rank(START, START)] << " under optimal play." << std::endl;
+    std::cout << "Wrote " << path << "." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+// Load the tablebase at `path` and time how long `TablebaseAgent` takes to move.
+int probe(const std::string& path) {
+    auto tablebase = std::make_shared<const Tablebase>(path);
+    if (!*tablebase) return EXIT_FAILURE;
+    std::cout << "The first player wins with probability "
+              << (*tablebase)[rank(START, START)] << " under optimal play." << std::endl;
+
+    std::vector<Decision> decisions = sampleDecisions(1 << 16);
+    TablebaseAgent agent(tablebase);
+    const size_t repeats = 64;
+    uint64_t checksum = 0;
+    double seconds = timeIt([&] {
+        for (size_t r = 0; r < repeats; ++r) {
+            for (const Decision& d : decisions) checksum += agent.getMove(d.self, d.other, d.steps, d.options);
+        }
+    });
+    std::cout << "TablebaseAgent takes " << seconds / (repeats * decisions.size()) * 1e9
+              << " ns per move (" << checksum << ")." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+// Compare expectiminimax with and without Star1/Star2 pruning.
+int search(unsigned depth) {
+    if (depth == 0 || depth > MAX_SEARCH_DEPTH) {
+        std::cerr << "The depth must be from 1 to " << MAX_SEARCH_DEPTH << " rolls." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<Decision> decisions = sampleDecisions(1 << 8);
+    ExpectiminimaxAgent plain(depth, false), pruned(depth, true);
+    std::vector<Position> moves;
+    std::vector<float> values;
+    for (const Decision& d : decisions) {
+        moves.push_back(plain.getMove(d.self, d.other, d.steps, d.options));
+        values.push_back(plain.value());
+    }
+    size_t disagreements = 0;
+    float error = 0;
+    auto compare = [&](ExpectiminimaxAgent& agent) {
+        for (size_t i = 0; i < decisions.size(); ++i) {
+            const Decision& d = decisions[i];
+            Position move = agent.getMove(d.self, d.other, d.steps, d.options);
+            error = std::max(error, std::abs(agent.value() - values[i]));
+            // Ties can legitimately go either way, so only count real differences.
+            if (move != moves[i] && std::abs(agent.value() - values[i]) > 1e-4) disagreements++;
+        }
+    };
+    compare(pruned);
+    std::cout << decisions.size() << " decisions, searched " << depth << " rolls deep." << std::endl;
+    std::cout << "Expectimax:   " << plain.stats << " (" << plain.stats.seconds << "s)" << std::endl;
+    std::cout << "Star1/Star2:  " << pruned.stats << " (" << pruned.stats.seconds << "s)" << std::endl;
+
+    // The same again, with a transposition table under each replacement policy.
+    using Replacement = TranspositionTable::Replacement;
+    for (auto [name, replacement] : {std::make_pair("always", Replacement::Always),
+                                     std::make_pair("deepest", Replacement::Deepest),
+                                     std::make_pair("aged", Replacement::Aged)}) {
+        ExpectiminimaxAgent tabled(depth, true, std::make_shared<TranspositionTable>(1, replacement));
+        compare(tabled);
+        std::cout << "+ 1MiB table, " << name << ": " << tabled.stats << " (" << tabled.stats.seconds << "s), "
+                  << (double(pruned.stats.nodes()) - tabled.stats.nodes()) / decisions.size()
+                  << " nodes saved per search" << std::endl;
+    }
+    std::cout << "Largest difference in value: " << error << std::endl;
+    return disagreements == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+// Time a tournament between the simple agents on 1, 2, 4, ... threads, up to
+// one per core, to see how well it scales. Every run rolls the same dice, so
+// they must all have the same result.
+int tournament(uint64_t games, uint64_t seed) {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << games << " games between FarthestAgent and ClosestAgent, seed " << seed << "." << std::endl;
+    // Through the vtable, as for any agent.
+    const AgentFactory farthest = [] { return std::make_unique<FarthestAgent>(); };
+    const AgentFactory closest = [] { return std::make_unique<ClosestAgent>(); };
+    double base = 0;
+    uint64_t firstWins = 0;
+    for (unsigned threads = 1; ; threads = std::min(cores, 2 * threads)) {
+        TournamentResult result = runTournament(farthest, closest, games, seed, threads);
+        if (threads == 1) {
+            base = result.gamesPerSecond();
+            firstWins = result.firstWins;
+        }
+        std::cout << threads << " threads: " << result.gamesPerSecond() << " games/s ("
+                  << result.gamesPerSecond() / base << "x), first player won "
+                  << result.firstWins << " / " << result.games << std::endl;
+        if (result.games != games || result.firstWins != firstWins) return EXIT_FAILURE;
+        if (threads == cores) break;
+    }
+    TournamentResult result = runTournament<PhiloxDice>(farthest, closest, games, seed, cores);
+    std::cout << "Philox dice: " << result.gamesPerSecond() << " games/s, first player won "
+              << result.firstWins << " / " << result.games << std::endl;
+
+    // The same games again, with the agents' moves called directly.
+    TournamentResult direct = runTournament<PhiloxDice>([] { return FarthestAgent(); },
+                                                        [] { return ClosestAgent(); }, games, seed, cores);
+    std::cout << "Devirtualized: " << direct.gamesPerSecond() << " games/s ("
+              << direct.gamesPerSecond() / result.gamesPerSecond() << "x), first player won "
+              << direct.firstWins << " / " << direct.games << std::endl;
+    if (direct.games != games || direct.firstWins != result.firstWins) return EXIT_FAILURE;
+
+    // The same games again, in lockstep.
+    TournamentResult lockstep = runLockstep(LanePolicy::Farthest, LanePolicy::Closest, games, seed, cores);
+    std::cout << "Lockstep (" << batchIsaName(BATCH_ISA) << "): " << lockstep.gamesPerSecond() << " games/s ("
+              << lockstep.gamesPerSecond() / result.gamesPerSecond() << "x), first player won "
+              << lockstep.firstWins << " / " << lockstep.games << std::endl;
+    if (lockstep.games != games || lockstep.firstWins != result.firstWins) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+
+// Compare two agents by name over pairs of seat-swapped games, once rolling
+// fresh dice for every game and once rolling the same dice for both games of
+// each pair, to see how many fewer games the latter needs.
+int match(const std::string& a, const std::string& b, uint64_t pairs, uint64_t seed) {
+    AgentFactory makeA = agentNamed(a), makeB = agentNamed(b);
+    if (!makeA || !makeB) {
+        std::cerr << "Unknown agent: " << (makeA ? b : a) << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << pairs << " pairs of games between " << a << " and " << b << ", seed " << seed << "." << std::endl;
+    MatchResult fresh = runMatch(makeA, makeB, pairs, seed, false);
+    MatchResult paired = runMatch(makeA, makeB, pairs, seed, true);
+    for (auto [name, result] : {std::make_pair("fresh dice:  ", fresh), std::make_pair("paired dice: ", paired)}) {
+        std::cout << name << a << " wins " << 100 * result.winRate() << "%, "
+                  << "difference " << 100 * result.difference() << " +/- " << 100 * result.halfWidth() << "% "
+                  << "(first seat wins " << 100 * result.firstWinRate() << "%, "
+                  << result.games() / result.seconds << " games/s)" << std::endl;
+    }
+    // With too few pairs (or agents that always tie), paired dice can show no
+    // variance at all, and there's no ratio to give.
+    if (paired.variance() > 0) {
+        std::cout << "Fresh dice need " << fresh.variance() / paired.variance()
+                  << "x as many games as paired dice for the same confidence." << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+// Test whether one agent is stronger than another by `margin` in win rate,
+// stopping as soon as the answer is clear, by SPRT and by the Bayesian rule.
+int sprt(const std::string& a, const std::string& b, double margin, uint64_t seed) {
+    AgentFactory makeA = agentNamed(a), makeB = agentNamed(b);
+    if (!makeA || !makeB) {
+        std::cerr << "Unknown agent: " << (makeA ? b : a) << std::endl;
+        return EXIT_FAILURE;
+    }
+    const uint64_t maxPairs = 10000;
+    std::cout << "Is " << a << " stronger than " << b << " by " << 100 * margin << "%? (at most "
+              << maxPairs << " pairs, seed " << seed << ")" << std::endl;
+    using Rule = SequentialTest::Rule;
+    using Verdict = SequentialTest::Verdict;
+    for (auto [name, rule] : {std::make_pair("SPRT:  ", Rule::Sprt), std::make_pair("Bayes: ", Rule::Bayes)}) {
+        SequentialTest test;
+        test.margin = margin;
+        test.rule = rule;
+        auto [result, verdict] = runSequentialMatch(makeA, makeB, maxPairs, seed, test);
+        std::cout << name << (verdict == Verdict::Stronger ? "yes" : verdict == Verdict::NotStronger ? "no" : "undecided")
+                  << " after " << result.pairs << " pairs (" << 100.0 * result.pairs / maxPairs << "% of "
+                  << maxPairs << "), difference " << 100 * result.difference() << " +/- "
+                  << 100 * result.halfWidth() << "%, " << result.seconds << "s" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+// Compute exactly how often one agent beats another, from either seat.
+int matchup(const std::string& a, const std::string& b) {
+    AgentFactory makeA = agentNamed(a), makeB = agentNamed(b);
+    if (!makeA || !makeB) {
+        std::cerr << "Unknown agent: " << (makeA ? b : a) << std::endl;
+        return EXIT_FAILURE;
+    }
+    Matchup exact;
+    double seconds = timeIt([&] { exact = evaluateMatchup(makeA, makeB); });
+    std::cout << "Exactly, " << a << " beats " << b << " with probability " << exact.aFirst
+              << " moving first, and " << exact.bFirst << " moving second (" << seconds << "s)." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+// Compute the exact distribution of game length between two agents.
+int lengths(const std::string& a, const std::string& b, double tolerance, size_t width) {
+    AgentFactory makeA = agentNamed(a), makeB = agentNamed(b);
+    if (!makeA || !makeB) {
+        std::cerr << "Unknown agent: " << (makeA ? b : a) << std::endl;
+        return EXIT_FAILURE;
+    }
+    GameLengths exact;
+    double seconds = timeIt([&] { exact = gameLengths(makeA, makeB, tolerance, width); });
+    std::cout << "Games between " << a << " (first) and " << b << " last " << exact.mean() << " rolls on average"
+              << " (standard deviation " << std::sqrt(exact.variance()) << "), and " << a
+              << " wins with probability " << exact.aWins << "." << std::endl;
+    for (double p : {0.01, 0.1, 0.5, 0.9, 0.99, 0.999, 0.9999, 0.99999}) {
+        // What was dropped might have lasted any length, so it only bounds
+        // the percentiles, and the highest are out of reach.
+        if (p > 1 - exact.truncated) break;
+        size_t fewest = exact.percentile(p - exact.truncated), most = exact.percentile(p);
+        std::cout << "  " << 100 * p << "% are over within ";
+        if (fewest != most) std::cout << fewest << " to ";
+        std::cout << most << " rolls" << std::endl;
+    }
+    std::cout << "The longest lasted " << exact.probability.size() - 1 << " rolls, at most " << exact.widest
+              << " positions were in play at once, and " << exact.truncated << " of the probability was dropped ("
+              << seconds << "s)." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+// Compute the best response to an agent, write it to a policy table at `path`,
+// and check it by playing it against the agent.
+int exploit(const std::string& name, const std::string& path) {
+    AgentFactory opponent = agentNamed(name);
+    if (!opponent) {
+        std::cerr << "Unknown agent: " << name << std::endl;
+        return EXIT_FAILURE;
+    }
+    TablebaseWriter writer(path, POLICY_MAGIC);
+    if (!writer) return EXIT_FAILURE;
+    Matchup exact;
+    double seconds = timeIt([&] { exact = bestResponse(opponent, &writer); });
+    if (!writer.commit()) return EXIT_FAILURE;
+    std::cout << "The best response to " << name << " wins with probability " << exact.aFirst
+              << " moving first, and " << exact.bFirst << " moving second (" << seconds << "s)." << std::endl;
+    std::cout << "Wrote " << path << "." << std::endl;
+
+    AgentFactory policy = agentNamed(path);
+    if (!policy) return EXIT_FAILURE;
+    MatchResult sampled = runMatch(policy, opponent, 10000, randomSeed());
+    std::cout << "Played back, it wins " << 100 * sampled.winRate() << "% of " << sampled.games()
+              << " games (exactly " << 50 * (exact.aFirst + exact.bFirst) << "%)." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+// Replay one game of a tournament between the simple agents, move by move.
+int replay(uint64_t seed, uint64_t game) {
+    std::unique_ptr<Agent> farthest = std::make_unique<FarthestAgent>();
+    std::unique_ptr<Agent> closest = std::make_unique<ClosestAgent>();
+    std::cout << "Game " << game << " of seed " << seed << "." << std::endl;
+    bool won = playOneGame(farthest, closest, Dice(seed, game), ConsoleObserver());
+    std::cout << (won ? farthest : closest)->getName() << " won." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+// Play a tournament like `tournament`, on every core, with and without logging
+// every game to `path` (as text, or as raw `LogEvent`s if it ends in ".bin"),
+// to see what the logging costs.
+int logGames(uint64_t games, uint64_t seed, const std::string& path) {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    const AgentFactory farthest = [] { return std::make_unique<FarthestAgent>(); };
+    const AgentFactory closest = [] { return std::make_unique<ClosestAgent>(); };
+    const bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    std::cout << games << " games between FarthestAgent and ClosestAgent, seed " << seed << ", logged to "
+              << path << (binary ? " (binary)" : " (text)") << "." << std::endl;
+
+    TournamentResult quiet = runTournament(farthest, closest, games, seed, cores);
+    std::cout << "Not logged: " << quiet.gamesPerSecond() << " games/s" << std::endl;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Couldn't open " << path << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+    GameLog log(out, binary ? LogFormat::Binary : LogFormat::Text);
+    TournamentResult logged;
+    double seconds = timeIt([&] {
+        logged = runTournament(farthest, closest, games, seed, cores, &log);
+        log.close();
+    });
+    std::cout << "Logged:     " << logged.gamesPerSecond() << " games/s while playing ("
+              << 100 * (quiet.gamesPerSecond() / logged.gamesPerSecond() - 1) << "% slower), "
+              << games / seconds << " games/s until written" << std::endl;
+    std::cout << log.events() << " events (" << double(log.events()) / games << " per game), the rings filled up "
+              << log.stalls() << " times" << std::endl;
+    if (!out || logged.firstWins != quiet.firstWins) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+
+// Play one game against the AI, then simulate many games between the AIs.
+int play() {
+    std::cout << "Hello, world! Welcome to the Royal Game of Ur." << std::endl;
+
+    // Construct some Ur-playing agents.
+    std::unique_ptr<Agent> sam = std::make_unique<InteractiveAgent>("Sam");
+    std::unique_ptr<Agent> closest = std::make_unique<ClosestAgent>();
+
+    // Play one game against the AI.
+    playOneGame(sam, closest, Dice(randomSeed()), ConsoleObserver());
+
+    // Simulate many games between the AIs, on every core. Any one of them can
+    // be watched again with `ur replay <seed> <game>`.
+    uint64_t seed = randomSeed();
+    TournamentResult result = runTournament([] { return std::make_unique<FarthestAgent>(); },
+                                            [] { return std::make_unique<ClosestAgent>(); }, 10000, seed);
+    std::cout << "First player won " << result.firstWins << " / " << result.games
+              << " (" << result.gamesPerSecond() << " games/s, seed " << seed << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+
+// The command-line arguments after the mode, parsed as they're asked for.
+//
+// An argument that should be a number but isn't one in range (e.g. "abc", or
+// "-1" for a count, which `std::stoull` would quietly wrap around) makes the
+// arguments false, so that the usage can be printed instead.
+class Arguments {
+public:
+    Arguments(int argc, char* argv[]) : _argc(argc), _argv(argv) { /* empty */ }
+
+    explicit operator bool() const { return _ok; }
+
+    // Whether there's an argument `i`.
+    [[ nodiscard ]] bool has(int i) const { return i < _argc; }
+
+    // Argument `i`, or `fallback` if there isn't one.
+    [[ nodiscard ]] std::string text(int i, const std::string& fallback) const {
+        return has(i) ? _argv[i] : fallback;
+    }
+
+    // Argument `i` as a number in [low, high], or `fallback` if there isn't one.
+    template <typename T>
+    [[ nodiscard ]] T number(int i, T fallback, T low = std::numeric_limits<T>::lowest(),
+                             T high = std::numeric_limits<T>::max()) {
+        if (!has(i)) return fallback;
+        T value{};
+        const char* end = _argv[i] + std::strlen(_argv[i]);
+        auto [stop, error] = std::from_chars(_argv[i], end, value);
+        // Written so that a NaN is out of range too.
+        if (error != std::errc() || stop != end || !(low <= value && value <= high)) {
+            std::cerr << "Not a number in range: " << _argv[i] << std::endl;
+            _ok = false;
+        }
+        return value;
+    }
+
+private:
+    int _argc;
+    char** _argv;
+    bool _ok = true;
+};
+
+
+// Play the Royal Game of Ur, repeatedly.
+//
+// Usage: ur [play|bench|verify|solve [path]|probe [path]|search [depth]|tournament [games] [seed]|replay seed game|log [games] [seed] [path]|match [a] [b] [pairs] [seed]|sprt [a] [b] [margin] [seed]|matchup [a] [b]|lengths [a] [b] [tolerance] [width]|exploit [agent] [path]]
+int main(int argc, char *argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "play";
+    Arguments args(argc, argv);
+    if (mode == "play") return play();
+    if (mode == "bench") return bench();
+    if (mode == "verify") return verify();
+    if (mode == "solve") return solve(args.text(2, "ur.tablebase"));
+    if (mode == "probe") return probe(args.text(2, "ur.tablebase"));
+    if (mode == "search") {
+        unsigned depth = args.number(2, 3u, 1u, MAX_SEARCH_DEPTH);
+        if (args) return search(depth);
+    }
+    if (mode == "tournament") {
+        uint64_t games = args.number<uint64_t>(2, 1000000, 1);
+        uint64_t seed = args.number<uint64_t>(3, randomSeed());
+        if (args) return tournament(games, seed);
+    }
+    if (mode == "replay" && args.has(3)) {
+        uint64_t seed = args.number<uint64_t>(2, 0);
+        uint64_t game = args.number<uint64_t>(3, 0);
+        if (args) return replay(seed, game);
+    }
+    if (mode == "log") {
+        uint64_t games = args.number<uint64_t>(2, 10000, 1);
+        uint64_t seed = args.number<uint64_t>(3, randomSeed());
+        if (args) return logGames(games, seed, args.text(4, "ur.log"));
+    }
+    if (mode == "matchup") return matchup(args.text(2, "farthest"), args.text(3, "closest"));
+    if (mode == "exploit") {
+        std::string name = args.text(2, "closest");
+        return exploit(name, args.text(3, name + ".policy"));
+    }
+    if (mode == "lengths") {
+        double tolerance = args.number(4, 1e-9, 0.0, 1.0);
+        size_t width = args.number<size_t>(5, 1 << 20, 1);
+        if (args) return lengths(args.text(2, "farthest"), args.text(3, "closest"), tolerance, width);
+    }
+    if (mode == "sprt") {
+        double margin = args.number(4, 0.05, std::numeric_limits<double>::min(), 1.0);
+        uint64_t seed = args.number<uint64_t>(5, randomSeed());
+        if (args) return sprt(args.text(2, "search1"), args.text(3, "closest"), margin, seed);
+    }
+    if (mode == "match") {
+        uint64_t pairs = args.number<uint64_t>(4, 10000, 1);
+        uint64_t seed = args.number<uint64_t>(5, randomSeed());
+        if (args) return match(args.text(2, "search1"), args.text(3, "closest"), pairs, seed);
+    }
+
+    std::cerr << "Usage: " << argv[0] << " [play|bench|verify|solve [path]|probe [path]|search [depth]|tournament [games] [seed]|replay seed game|log [games] [seed] [path]|match [a] [b] [pairs] [seed]|sprt [a] [b] [margin] [seed]|matchup [a] [b]|lengths [a] [b] [tolerance] [width]|exploit [agent] [path]]" << std::endl;
+    return EXIT_FAILURE;
 }